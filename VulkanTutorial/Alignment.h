@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Rounds value up to a multiple of alignment, which does not have to be a power of two
+inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
@@ -0,0 +1,238 @@
+#include "BindlessDescriptors.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static const VkDescriptorType DESCRIPTOR_TYPES[3] = {
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+	VK_DESCRIPTOR_TYPE_SAMPLER
+};
+
+bool BindlessDescriptors::isSupported(const Device& device)
+{
+	const VkPhysicalDeviceVulkan12Features& features = device.getEnabledVulkan12Features();
+	return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending
+		&& features.descriptorBindingStorageBufferUpdateAfterBind && features.descriptorBindingSampledImageUpdateAfterBind;
+}
+
+BindlessDescriptors::BindlessDescriptors(Device& device, const std::vector<VkDescriptorSetLayout>& extraSetLayouts, uint32_t maxBuffers,
+	uint32_t maxImages, uint32_t maxSamplers)
+	: _device{ device }
+{
+	if (!isSupported(_device)) {
+		throw std::runtime_error("Bindless descriptors require descriptor indexing with update after bind!");
+	}
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+	VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(_device.getPhysicalDevice(), &properties);
+
+	// Every stage sees the whole set, so the per-stage limits apply as well
+	_handles[static_cast<int>(ResourceType::Buffer)].capacity = std::min({ maxBuffers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+	_handles[static_cast<int>(ResourceType::Image)].capacity = std::min({ maxImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	_handles[static_cast<int>(ResourceType::Sampler)].capacity = std::min({ maxSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+	// The three arrays together must also fit the per-stage resource limit, buffers and images give way first
+	uint32_t resourceLimit = indexingProperties.maxPerStageUpdateAfterBindResources;
+	uint32_t& bufferCapacity = _handles[static_cast<int>(ResourceType::Buffer)].capacity;
+	uint32_t& imageCapacity = _handles[static_cast<int>(ResourceType::Image)].capacity;
+	uint32_t samplerCapacity = _handles[static_cast<int>(ResourceType::Sampler)].capacity;
+	if (static_cast<uint64_t>(bufferCapacity) + imageCapacity + samplerCapacity > resourceLimit)
+	{
+		uint32_t available = resourceLimit > samplerCapacity ? resourceLimit - samplerCapacity : 0;
+		bufferCapacity = std::min(bufferCapacity, available / 2);
+		imageCapacity = std::min(imageCapacity, available - bufferCapacity);
+	}
+
+	for (const HandleAllocator& handles : _handles)
+	{
+		if (handles.capacity == 0) {
+			throw std::runtime_error("Device limits leave no room for bindless descriptors!");
+		}
+	}
+
+	createDescriptorSet();
+	createPipelineLayout(extraSetLayouts);
+}
+
+BindlessDescriptors::~BindlessDescriptors()
+{
+	vkDestroyPipelineLayout(_device.getDevice(), _pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(_device.getDevice(), _descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(_device.getDevice(), _descriptorSetLayout, nullptr);
+}
+
+uint32_t BindlessDescriptors::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32_t handle = allocateHandle(ResourceType::Buffer);
+	write(ResourceType::Buffer, handle, &bufferInfo, nullptr);
+	return handle;
+}
+
+uint32_t BindlessDescriptors::addImage(VkImageView imageView, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = layout;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32_t handle = allocateHandle(ResourceType::Image);
+	write(ResourceType::Image, handle, nullptr, &imageInfo);
+	return handle;
+}
+
+uint32_t BindlessDescriptors::addSampler(VkSampler sampler)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32_t handle = allocateHandle(ResourceType::Sampler);
+	write(ResourceType::Sampler, handle, nullptr, &imageInfo);
+	return handle;
+}
+
+void BindlessDescriptors::release(ResourceType type, uint32_t handle)
+{
+	uint64_t timelineValue = _device.getLastTimelineValue(QueueType::Graphic);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	HandleAllocator& handles = _handles[static_cast<int>(type)];
+	if (handle >= handles.next) {
+		throw std::runtime_error("Released a bindless handle that was never allocated!");
+	}
+	handles.pending.push_back({ timelineValue, handle });
+}
+
+void BindlessDescriptors::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint)
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+}
+
+void BindlessDescriptors::pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset)
+{
+	vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_ALL, offset, size, data);
+}
+
+void BindlessDescriptors::createDescriptorSet()
+{
+	VkDescriptorSetLayoutBinding bindings[3] = {};
+	VkDescriptorBindingFlags bindingFlags[3] = {};
+	VkDescriptorPoolSize poolSizes[3] = {};
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = DESCRIPTOR_TYPES[i];
+		bindings[i].descriptorCount = _handles[i].capacity;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+
+		// Unused slots stay unwritten, and free slots are rewritten while frames using other slots are in flight
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		poolSizes[i].type = DESCRIPTOR_TYPES[i];
+		poolSizes[i].descriptorCount = _handles[i].capacity;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+	bindingFlagsInfo.bindingCount = 3;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(_device.getDevice(), &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(_device.getDevice(), &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocateInfo.descriptorPool = _descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &_descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(_device.getDevice(), &allocateInfo, &_descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+	}
+}
+
+void BindlessDescriptors::createPipelineLayout(const std::vector<VkDescriptorSetLayout>& extraSetLayouts)
+{
+	std::vector<VkDescriptorSetLayout> setLayouts = { _descriptorSetLayout };
+	setLayouts.insert(setLayouts.end(), extraSetLayouts.begin(), extraSetLayouts.end());
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+	pushConstantRange.size = PUSH_CONSTANT_SIZE;
+
+	VkPipelineLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	layoutInfo.pSetLayouts = setLayouts.data();
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device.getDevice(), &layoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless pipeline layout!");
+	}
+}
+
+uint32_t BindlessDescriptors::allocateHandle(ResourceType type)
+{
+	HandleAllocator& handles = _handles[static_cast<int>(type)];
+
+	// Released handles become free once the graphic queue is past their release
+	while (!handles.pending.empty() && _device.isTimelineReached(QueueType::Graphic, handles.pending.front().timelineValue))
+	{
+		handles.freeHandles.push_back(handles.pending.front().handle);
+		handles.pending.pop_front();
+	}
+
+	if (!handles.freeHandles.empty())
+	{
+		uint32_t handle = handles.freeHandles.back();
+		handles.freeHandles.pop_back();
+		return handle;
+	}
+
+	if (handles.next == handles.capacity) {
+		throw std::runtime_error("Out of bindless descriptor handles!");
+	}
+	return handles.next++;
+}
+
+void BindlessDescriptors::write(ResourceType type, uint32_t handle, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo)
+{
+	VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	write.dstSet = _descriptorSet;
+	write.dstBinding = static_cast<uint32_t>(type);
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = DESCRIPTOR_TYPES[static_cast<int>(type)];
+	write.pBufferInfo = bufferInfo;
+	write.pImageInfo = imageInfo;
+
+	vkUpdateDescriptorSets(_device.getDevice(), 1, &write, 0, nullptr);
+}
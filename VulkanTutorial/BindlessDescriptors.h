@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Device.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// One global descriptor set holding every buffer, image and sampler in large update-after-bind arrays.
+// Resources are registered once and addressed by stable handles that shaders get through push constants,
+// so a frame binds the set once and draws switch resources without allocating or binding descriptors
+class BindlessDescriptors
+{
+public:
+	// Also the binding of the array in set 0
+	enum class ResourceType
+	{
+		Buffer,
+		Image,
+		Sampler
+	};
+
+	// Every device supports at least this much, shared by all stages of the layout
+	static const uint32_t PUSH_CONSTANT_SIZE = 128;
+
+	// Requires runtime descriptor arrays, partially bound bindings and update after bind for buffers and images
+	static bool isSupported(const Device& device);
+
+	// Array sizes are clamped to the device's update-after-bind limits. The shared pipeline layout has
+	// the bindless set as set 0 followed by extraSetLayouts
+	BindlessDescriptors(Device& device, const std::vector<VkDescriptorSetLayout>& extraSetLayouts = {}, uint32_t maxBuffers = 65536,
+		uint32_t maxImages = 16384, uint32_t maxSamplers = 256);
+	~BindlessDescriptors();
+
+	BindlessDescriptors(const BindlessDescriptors&) = delete;
+	BindlessDescriptors& operator=(const BindlessDescriptors&) = delete;
+
+	// Thread safe. The descriptor is written right away, command buffers already recorded keep working
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	uint32_t addImage(VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t addSampler(VkSampler sampler);
+	// The handle is reused once the graphic queue has finished everything submitted before the release,
+	// so the resource must not be used by work submitted after it. Only from the thread submitting to the graphic queue
+	void release(ResourceType type, uint32_t handle);
+
+	// Every pipeline using the bindless set shares this layout
+	VkPipelineLayout getPipelineLayout() const { return _pipelineLayout; }
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint);
+	// Pushes to every stage, size is at most PUSH_CONSTANT_SIZE
+	void pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset = 0);
+
+	uint32_t getCapacity(ResourceType type) const { return _handles[static_cast<int>(type)].capacity; }
+
+private:
+	struct PendingRelease
+	{
+		uint64_t timelineValue;
+		uint32_t handle;
+	};
+
+	struct HandleAllocator
+	{
+		uint32_t capacity = 0;
+		// Handles below it were handed out at least once
+		uint32_t next = 0;
+		std::vector<uint32_t> freeHandles;
+		// In release order, so also in timeline order
+		std::deque<PendingRelease> pending;
+	};
+
+	Device& _device;
+
+	VkDescriptorSetLayout _descriptorSetLayout;
+	VkDescriptorPool _descriptorPool;
+	VkDescriptorSet _descriptorSet;
+	VkPipelineLayout _pipelineLayout;
+
+	// Indexed by ResourceType
+	HandleAllocator _handles[3];
+	std::mutex _mutex;
+
+	void createDescriptorSet();
+	void createPipelineLayout(const std::vector<VkDescriptorSetLayout>& extraSetLayouts);
+
+	// Must be called with _mutex locked
+	uint32_t allocateHandle(ResourceType type);
+	void write(ResourceType type, uint32_t handle, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo);
+};
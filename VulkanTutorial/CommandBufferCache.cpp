@@ -0,0 +1,41 @@
+#include "CommandBufferCache.h"
+
+CommandBufferCache::CommandBufferCache(Device& device, size_t imageCount, RecordFunction record)
+	: _device{ device }, _record{ std::move(record) }, _commandBuffers(imageCount), _dirtyFlags(imageCount, DIRTY_ALL)
+{
+	VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocateInfo.commandPool = _device.getCommandPool();
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
+
+	if (vkAllocateCommandBuffers(_device.getDevice(), &allocateInfo, _commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate cached command buffers!");
+	}
+}
+
+CommandBufferCache::~CommandBufferCache()
+{
+	vkFreeCommandBuffers(_device.getDevice(), _device.getCommandPool(), static_cast<uint32_t>(_commandBuffers.size()), _commandBuffers.data());
+}
+
+void CommandBufferCache::markDirty(uint32_t flags)
+{
+	for (uint32_t& dirtyFlags : _dirtyFlags) {
+		dirtyFlags |= flags;
+	}
+}
+
+VkCommandBuffer CommandBufferCache::get(uint32_t imageIndex)
+{
+	VkCommandBuffer commandBuffer = _commandBuffers[imageIndex];
+
+	if (_dirtyFlags[imageIndex] != 0)
+	{
+		// The pool allows individual resets, so beginning the buffer again discards the old commands
+		_record(commandBuffer, imageIndex);
+		_dirtyFlags[imageIndex] = 0;
+		++_recordCount;
+	}
+
+	return commandBuffer;
+}
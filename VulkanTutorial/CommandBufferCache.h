@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Device.h"
+
+#include <functional>
+
+// One pre-recorded command buffer per swapchain image. Buffers are replayed as-is
+// until something they depend on is marked dirty, then re-recorded on next use
+class CommandBufferCache
+{
+public:
+	enum DirtyFlagBits : uint32_t
+	{
+		DIRTY_PIPELINE = 1 << 0,
+		DIRTY_RENDER_TARGETS = 1 << 1,
+		DIRTY_DRAWS = 1 << 2,
+		DIRTY_ALL = ~0u
+	};
+
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t imageIndex)>;
+
+	CommandBufferCache(Device& device, size_t imageCount, RecordFunction record);
+	~CommandBufferCache();
+
+	CommandBufferCache(const CommandBufferCache&) = delete;
+	CommandBufferCache& operator=(const CommandBufferCache&) = delete;
+
+	void markDirty(uint32_t flags);
+	void markDirty(uint32_t imageIndex, uint32_t flags) { _dirtyFlags[imageIndex] |= flags; }
+	uint32_t getDirtyFlags(uint32_t imageIndex) const { return _dirtyFlags[imageIndex]; }
+
+	// The caller must make sure the previous submission of this image has completed
+	VkCommandBuffer get(uint32_t imageIndex);
+
+	// Number of times any buffer was (re-)recorded
+	uint64_t getRecordCount() const { return _recordCount; }
+
+private:
+	Device& _device;
+	RecordFunction _record;
+
+	std::vector<VkCommandBuffer> _commandBuffers;
+	std::vector<uint32_t> _dirtyFlags;
+	uint64_t _recordCount = 0;
+};
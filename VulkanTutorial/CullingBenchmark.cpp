@@ -0,0 +1,101 @@
+#include "CullingBenchmark.h"
+
+#include "JobSystem.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Repeated until this much time has passed, the fastest run is reported
+static const double MINIMUM_BENCHMARK_SECONDS = 0.2;
+
+// Scattered over four times the visible area, so about a quarter survives like in a scene seen from inside
+static void fillScene(Scene& scene, uint32_t objectCount)
+{
+	std::mt19937 random(objectCount);
+	std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::uniform_real_distribution<float> radius(0.001f, 0.05f);
+
+	scene.clear();
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		float center[3] = { position(random), position(random), depth(random) };
+		scene.addObject(center, radius(random), i, 1);
+	}
+}
+
+static double bestNanoseconds(const Scene& scene, const Frustum& frustum, std::vector<uint32_t>& visible, JobSystem* jobSystem,
+	uint32_t& visibleCount)
+{
+	double best = 0.0;
+	double total = 0.0;
+	for (int run = 0; run < 3 || total < MINIMUM_BENCHMARK_SECONDS * 1e9; ++run)
+	{
+		auto start = Clock::now();
+		visibleCount = scene.cull(frustum, visible, jobSystem);
+		double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		total += nanoseconds;
+		if (run == 0 || nanoseconds < best) {
+			best = nanoseconds;
+		}
+	}
+	return best;
+}
+
+void runCullingBenchmark(std::ostream& out, uint32_t jobThreads)
+{
+	JobSystem jobSystem(jobThreads);
+
+	const float view[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+	Frustum frustum = Frustum::fromView(view);
+
+	std::vector<Scene::CullPath> paths = { Scene::CullPath::Scalar };
+	if (Scene::getBestCullPath() != Scene::CullPath::Scalar) {
+		paths.push_back(Scene::CullPath::Sse);
+	}
+	if (Scene::getBestCullPath() == Scene::CullPath::Avx2) {
+		paths.push_back(Scene::CullPath::Avx2);
+	}
+
+	Scene scene;
+	std::vector<uint32_t> visible;
+
+	for (uint32_t objectCount : { 10000u, 100000u, 1000000u })
+	{
+		fillScene(scene, objectCount);
+		out << objectCount << " objects:";
+
+		uint32_t expectedCount = 0;
+		for (Scene::CullPath path : paths)
+		{
+			scene.setCullPath(path);
+
+			uint32_t visibleCount;
+			double nanoseconds = bestNanoseconds(scene, frustum, visible, nullptr, visibleCount);
+			out << " " << Scene::getCullPathName(path) << " " << nanoseconds / objectCount << " ns/object,";
+
+			// The paths must agree exactly, a faster wrong answer is no result
+			if (path == Scene::CullPath::Scalar) {
+				expectedCount = visibleCount;
+			}
+			else if (visibleCount != expectedCount) {
+				throw std::runtime_error("Culling paths disagree on the visible object count!");
+			}
+		}
+
+		uint32_t visibleCount;
+		double nanoseconds = bestNanoseconds(scene, frustum, visible, &jobSystem, visibleCount);
+		out << " " << Scene::getCullPathName(scene.getCullPath()) << " on " << jobSystem.getThreadCount() << " threads "
+			<< nanoseconds / objectCount << " ns/object, " << visibleCount << " visible" << std::endl;
+
+		if (visibleCount != expectedCount) {
+			throw std::runtime_error("Parallel culling disagrees on the visible object count!");
+		}
+	}
+}
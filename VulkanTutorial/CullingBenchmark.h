@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Nanoseconds per object of Scene::cull at 10k, 100k and 1M objects for every culling path the CPU supports,
+// single threaded and split across a job system of jobThreads threads (0 for one per core)
+void runCullingBenchmark(std::ostream& out, uint32_t jobThreads = 0);
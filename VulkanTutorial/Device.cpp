@@ -1,27 +1,51 @@
 #include "Device.h"
 
-Device::Device(GLFWwindow* window)
+#include "StartupTracer.h"
+
+#include <cstring>
+#include <future>
+
+Device::Device(GLFWwindow* window) : _headless{ window == nullptr }, _surface{ VK_NULL_HANDLE }
 {
 	createInstance();
-	createSurface(window);
+	if (!_headless) {
+		createSurface(window);
+	}
 	pickPhysicalDevice();
 	createLogicalDevice();
+
+	// Independent of each other, the semaphores are created while the pools and the allocator are set up
+	std::future<void> timelines = std::async(std::launch::async, [this]() { createTimelines(); });
 	createCommandPool();
+	createAllocator();
+	timelines.get();
 }
 
 Device::~Device()
 {
+	_allocator.reset();
+
+	for (VkSemaphore timeline : _timelines) {
+		vkDestroySemaphore(_device, timeline, nullptr);
+	}
+
+	vkDestroyCommandPool(_device, _computeCommandPool, nullptr);
+	vkDestroyCommandPool(_device, _transferCommandPool, nullptr);
 	vkDestroyCommandPool(_device, _commandPool, nullptr);
 
 	vkDestroyDevice(_device, nullptr);
 
-	vkDestroySurfaceKHR(_instance, _surface, nullptr);
+	if (_surface != VK_NULL_HANDLE) {
+		vkDestroySurfaceKHR(_instance, _surface, nullptr);
+	}
 
 	vkDestroyInstance(_instance, nullptr);
 }
 
 void Device::createInstance()
 {
+	StartupTracer::Scope scope("Device::createInstance");
+
 	VkApplicationInfo appInfo = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
 	appInfo.apiVersion = VK_API_VERSION_1_2;
 
@@ -32,18 +56,32 @@ void Device::createInstance()
 		createInfo.ppEnabledLayerNames = validationLayers.data();
 		createInfo.enabledLayerCount = validationLayers.size();
 	}
-	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
-	createInfo.enabledExtensionCount = instanceExtensions.size();
 
-	if (vkCreateInstance(&createInfo, nullptr, &_instance) != VK_SUCCESS) {
+	std::vector<const char*> extensions = getRequiredInstanceExtensions();
+	createInfo.ppEnabledExtensionNames = extensions.data();
+	createInfo.enabledExtensionCount = extensions.size();
+
+	VkResult result;
+	{
+		// Loads the layers and the ICDs, usually the slowest call of the whole startup
+		StartupTracer::Scope callScope("vkCreateInstance", StartupTracer::Kind::DriverCall);
+		result = vkCreateInstance(&createInfo, nullptr, &_instance);
+	}
+
+	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create intance!");
 	}
 }
 
 void Device::pickPhysicalDevice()
 {
+	StartupTracer::Scope scope("Device::pickPhysicalDevice");
+
 	uint32_t physicalDeviceCount;
-	vkEnumeratePhysicalDevices(_instance, &physicalDeviceCount, nullptr);
+	{
+		StartupTracer::Scope callScope("vkEnumeratePhysicalDevices", StartupTracer::Kind::DriverCall);
+		vkEnumeratePhysicalDevices(_instance, &physicalDeviceCount, nullptr);
+	}
 
 	if (physicalDeviceCount == 0) {
 		throw std::runtime_error("Failed to find GPU with Vulkan support!");
@@ -52,18 +90,22 @@ void Device::pickPhysicalDevice()
 	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
 	vkEnumeratePhysicalDevices(_instance, &physicalDeviceCount, physicalDevices.data());
 
-	std::map<int, VkPhysicalDevice> candidates;
+	// The queue families of the chosen device are kept, nothing queries them again
+	std::map<int, std::pair<VkPhysicalDevice, QueueFamilyIndices>> candidates;
 	for (const VkPhysicalDevice& physicalDevice : physicalDevices)
 	{
-		if (isPhysicalDeviceSuitable(physicalDevice))
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		if (isPhysicalDeviceSuitable(physicalDevice, indices))
 		{
 			int score = ratePhysicalDeviceSuitability(physicalDevice);
-			candidates.insert(std::make_pair(score, physicalDevice));
+			candidates.insert(std::make_pair(score, std::make_pair(physicalDevice, indices)));
 		}
 	}
 
-	if (candidates.rbegin()->first > 0) {
-		_physicalDevice = candidates.rbegin()->second;
+	if (!candidates.empty())
+	{
+		_physicalDevice = candidates.rbegin()->second.first;
+		_queueFamilies = candidates.rbegin()->second.second;
 	}
 	else {
 		throw std::runtime_error("Failed to find suitable GPU!");
@@ -72,6 +114,8 @@ void Device::pickPhysicalDevice()
 
 void Device::createSurface(GLFWwindow* window)
 {
+	StartupTracer::Scope scope("Device::createSurface");
+
 	if (glfwCreateWindowSurface(_instance, window, nullptr, &_surface) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create window surface!");
 	}
@@ -79,10 +123,12 @@ void Device::createSurface(GLFWwindow* window)
 
 void Device::createLogicalDevice()
 {
-	QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
+	StartupTracer::Scope scope("Device::createLogicalDevice");
+
+	const QueueFamilyIndices& indices = _queueFamilies;
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<int> uniqueQueueFamilies = { indices.graphicFamily, indices.presentFamily };
+	std::set<int> uniqueQueueFamilies = { indices.graphicFamily, indices.presentFamily, indices.transferFamily, indices.computeFamily };
 
 	float queuePriority = 1.0f;
 	for (int queueFamily : uniqueQueueFamilies)
@@ -95,32 +141,166 @@ void Device::createLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	std::vector<const char*> extensions = getRequiredDeviceExtensions();
+
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+	VkPhysicalDeviceFeatures2 supportedFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+	// The 1.2 feature struct may only be chained on devices that implement 1.2
+	bool vulkan12 = getProperties().apiVersion >= VK_API_VERSION_1_2;
+	if (vulkan12) {
+		supportedFeatures.pNext = &supportedVulkan12Features;
+	}
+#ifdef VK_KHR_dynamic_rendering
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR supportedDynamicRendering = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR };
+	// Its dependencies, depth_stencil_resolve and create_renderpass2, are core in 1.2
+	bool dynamicRenderingExtension = vulkan12 && isDeviceExtensionSupported(_physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	if (dynamicRenderingExtension) {
+		supportedVulkan12Features.pNext = &supportedDynamicRendering;
+	}
+#endif
+	vkGetPhysicalDeviceFeatures2(_physicalDevice, &supportedFeatures);
+
+	_enabledFeatures = {};
+	_enabledFeatures.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+	_enabledFeatures.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+	_enabledFeatures.pipelineStatisticsQuery = supportedFeatures.features.pipelineStatisticsQuery;
+
+	_enabledVulkan12Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+	_enabledVulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+	_enabledVulkan12Features.timelineSemaphore = supportedVulkan12Features.timelineSemaphore;
+	// Descriptor indexing for the bindless set
+	_enabledVulkan12Features.runtimeDescriptorArray = supportedVulkan12Features.runtimeDescriptorArray;
+	_enabledVulkan12Features.descriptorBindingPartiallyBound = supportedVulkan12Features.descriptorBindingPartiallyBound;
+	_enabledVulkan12Features.descriptorBindingUpdateUnusedWhilePending = supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+	_enabledVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind;
+	_enabledVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+	_enabledVulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+	_enabledVulkan12Features.shaderStorageBufferArrayNonUniformIndexing = supportedVulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+
+	// All queue and frame synchronization is built on them
+	if (!_enabledVulkan12Features.timelineSemaphore) {
+		throw std::runtime_error("Timeline semaphores are required!");
+	}
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features = _enabledVulkan12Features;
+	VkPhysicalDeviceFeatures2 enabledFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+	enabledFeatures.features = _enabledFeatures;
+	if (vulkan12) {
+		enabledFeatures.pNext = &vulkan12Features;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	bool dynamicRendering = dynamicRenderingExtension && supportedDynamicRendering.dynamicRendering;
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR };
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	if (dynamicRendering)
+	{
+		vulkan12Features.pNext = &dynamicRenderingFeatures;
+		extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	}
+#endif
+
 	VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+	createInfo.pNext = &enabledFeatures;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = queueCreateInfos.size();
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-	createInfo.enabledExtensionCount = deviceExtensions.size();
+	createInfo.ppEnabledExtensionNames = extensions.data();
+	createInfo.enabledExtensionCount = extensions.size();
+
+	VkResult result;
+	{
+		StartupTracer::Scope callScope("vkCreateDevice", StartupTracer::Kind::DriverCall);
+		result = vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_device);
+	}
 
-	if (vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_device) != VK_SUCCESS) {
+	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create logical device!");
 	}
 
+#ifdef VK_KHR_dynamic_rendering
+	if (dynamicRendering)
+	{
+		_vkCmdBeginRenderingKHR = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(_device, "vkCmdBeginRenderingKHR"));
+		_vkCmdEndRenderingKHR = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(_device, "vkCmdEndRenderingKHR"));
+		if (!_vkCmdBeginRenderingKHR || !_vkCmdEndRenderingKHR) {
+			_vkCmdBeginRenderingKHR = nullptr;
+			_vkCmdEndRenderingKHR = nullptr;
+		}
+	}
+#endif
+
 	vkGetDeviceQueue(_device, indices.graphicFamily, 0, &_graphicQueue);
 	vkGetDeviceQueue(_device, indices.presentFamily, 0, &_presentQueue);
+	vkGetDeviceQueue(_device, indices.transferFamily, 0, &_transferQueue);
+	vkGetDeviceQueue(_device, indices.computeFamily, 0, &_computeQueue);
 }
 
 void Device::createCommandPool()
 {
-	QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
+	StartupTracer::Scope scope("Device::createCommandPool");
+
+	_commandPool = createCommandPool(_queueFamilies.graphicFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	_transferCommandPool = createCommandPool(_queueFamilies.transferFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	_computeCommandPool = createCommandPool(_queueFamilies.computeFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+}
+
+void Device::createTimelines()
+{
+	StartupTracer::Scope scope("Device::createTimelines");
+
+	VkSemaphoreTypeCreateInfo typeInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo createInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	createInfo.pNext = &typeInfo;
+
+	for (VkSemaphore& timeline : _timelines)
+	{
+		if (vkCreateSemaphore(_device, &createInfo, nullptr, &timeline) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timeline semaphore!");
+		}
+	}
+}
 
+VkResult Device::waitTimeline(QueueType queue, uint64_t value)
+{
+	VkSemaphore timeline = getTimeline(queue);
+
+	VkSemaphoreWaitInfo waitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timeline;
+	waitInfo.pValues = &value;
+
+	return vkWaitSemaphores(_device, &waitInfo, UINT64_MAX);
+}
+
+bool Device::isTimelineReached(QueueType queue, uint64_t value)
+{
+	uint64_t currentValue = 0;
+	return vkGetSemaphoreCounterValue(_device, getTimeline(queue), &currentValue) == VK_SUCCESS && currentValue >= value;
+}
+
+VkCommandPool Device::createCommandPool(uint32_t queueFamily, VkCommandPoolCreateFlags flags)
+{
 	VkCommandPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-	createInfo.queueFamilyIndex = indices.graphicFamily;
+	createInfo.queueFamilyIndex = queueFamily;
+	createInfo.flags = flags;
 
-	if (vkCreateCommandPool(_device, &createInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(_device, &createInfo, nullptr, &commandPool) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create command pool!");
 	}
+
+	return commandPool;
 }
 
+void Device::createAllocator()
+{
+	StartupTracer::Scope scope("Device::createAllocator");
+
+	_allocator = std::make_unique<MemoryAllocator>(_device, _physicalDevice);
+}
 
 int Device::ratePhysicalDeviceSuitability(VkPhysicalDevice physicalDevice)
 {
@@ -141,17 +321,15 @@ int Device::ratePhysicalDeviceSuitability(VkPhysicalDevice physicalDevice)
 	return score;
 }
 
-bool Device::isPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice)
+bool Device::isPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice, const QueueFamilyIndices& indices)
 {
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-
 	bool isExtensionSuppoted = checkDeviceExtensionSupport(physicalDevice);
 
-	bool isSwapChainSuppotRightFormat = false;
-	if (isExtensionSuppoted)
+	bool isSwapChainSuppotRightFormat = _headless;
+	if (isExtensionSuppoted && !_headless)
 	{
 		SwapChainSupportDetails swapChainDetails = querySwapChainSupport(physicalDevice);
-		isSwapChainSuppotRightFormat = swapChainDetails.formats.empty() && swapChainDetails.presentModes.empty();
+		isSwapChainSuppotRightFormat = !swapChainDetails.formats.empty() && !swapChainDetails.presentModes.empty();
 	}
 
 	return indices.isComplete() && isExtensionSuppoted && isSwapChainSuppotRightFormat;
@@ -169,14 +347,20 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice physicalDevice)
 
 	for (int i = 0; i < queueFamilyCount; ++i)
 	{
-		if (queueFamilies[i].queueFlags == VK_QUEUE_GRAPHICS_BIT)
+		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 		{
 			indices.graphicFamily = i;
 			indices.graphicFamilyHasValue = true;
 		}
 
+		// Without a surface nothing is presented, so the graphic queue stands in for the present queue
 		VkBool32 isPresentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _surface, &isPresentSupport);
+		if (_headless) {
+			isPresentSupport = indices.graphicFamilyHasValue && indices.graphicFamily == i;
+		}
+		else {
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _surface, &isPresentSupport);
+		}
 
 		if (isPresentSupport == true)
 		{
@@ -188,9 +372,81 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice physicalDevice)
 			break;
 		}
 	}
+
+	// Transfer-only and compute-without-graphics families run alongside the graphic queue
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+		if (!indices.transferFamilyIsDedicated && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transferFamily = static_cast<int>(i);
+			indices.transferFamilyIsDedicated = true;
+		}
+
+		if (!indices.computeFamilyIsDedicated && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.computeFamily = static_cast<int>(i);
+			indices.computeFamilyIsDedicated = true;
+		}
+	}
+
+	if (indices.graphicFamilyHasValue)
+	{
+		if (!indices.transferFamilyIsDedicated) {
+			indices.transferFamily = indices.graphicFamily;
+		}
+		if (!indices.computeFamilyIsDedicated) {
+			indices.computeFamily = indices.graphicFamily;
+		}
+	}
+
 	return indices;
 }
 
+std::vector<const char*> Device::getRequiredInstanceExtensions()
+{
+	if (_headless) {
+		return {};
+	}
+
+	uint32_t glfwExtensionCount = 0;
+	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+	if (glfwExtensions == nullptr) {
+		throw std::runtime_error("Failed to query surface instance extensions!");
+	}
+
+	return std::vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount);
+}
+
+std::vector<const char*> Device::getRequiredDeviceExtensions()
+{
+	if (_headless) {
+		return {};
+	}
+
+	return deviceExtensions;
+}
+
+bool Device::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions)
+	{
+		if (std::string(extension.extensionName) == extensionName) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {
 	uint32_t extensionCount;
@@ -199,7 +455,8 @@ bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device)
 	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+	std::vector<const char*> extensions = getRequiredDeviceExtensions();
+	std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
 	for (const auto& extension : availableExtensions) {
 		requiredExtensions.erase(extension.extensionName);
@@ -232,3 +489,246 @@ SwapChainSupportDetails Device::querySwapChainSupport(VkPhysicalDevice physicalD
 
 	return swapChainDetails;
 }
+
+uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+	return _allocator->findMemoryType(typeFilter, properties);
+}
+
+VkFormat Device::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+{
+	for (VkFormat format : candidates)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &properties);
+
+		VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+		if ((supported & features) == features) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("Failed to find a supported format!");
+}
+
+VkCommandBuffer Device::beginSingleTimeCommands()
+{
+	return allocateOneTimeCommands(_commandPool);
+}
+
+VkCommandBuffer Device::allocateOneTimeCommands(VkCommandPool commandPool)
+{
+	VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(_device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+{
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSemaphore timeline = getTimeline(QueueType::Graphic);
+	uint64_t signalValue = nextTimelineValue(QueueType::Graphic);
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline;
+
+	VkResult result = vkQueueSubmit(_graphicQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (result == VK_SUCCESS) {
+		result = waitTimeline(QueueType::Graphic, signalValue);
+	}
+
+	vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit single time commands!");
+	}
+}
+
+void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, uint32_t dstQueueFamily)
+{
+	const QueueFamilyIndices& indices = _queueFamilies;
+	uint32_t transferFamily = indices.transferFamily;
+	if (dstQueueFamily == VK_QUEUE_FAMILY_IGNORED) {
+		dstQueueFamily = indices.graphicFamily;
+	}
+
+	VkCommandBuffer transferCommands = allocateOneTimeCommands(_transferCommandPool);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = size;
+	vkCmdCopyBuffer(transferCommands, srcBuffer, dstBuffer, 1, &copyRegion);
+
+	VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+	VkCommandPool acquirePool = VK_NULL_HANDLE;
+	VkQueue acquireQueue = VK_NULL_HANDLE;
+	QueueType acquireQueueType = QueueType::Graphic;
+
+	if (transferFamily != dstQueueFamily)
+	{
+		// Ownership moves with a release on the transfer queue and a matching acquire on the destination queue
+		VkBufferMemoryBarrier ownershipBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		ownershipBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		ownershipBarrier.srcQueueFamilyIndex = transferFamily;
+		ownershipBarrier.dstQueueFamilyIndex = dstQueueFamily;
+		ownershipBarrier.buffer = dstBuffer;
+		ownershipBarrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 1, &ownershipBarrier, 0, nullptr);
+
+		bool toCompute = dstQueueFamily == static_cast<uint32_t>(indices.computeFamily) && indices.computeFamilyIsDedicated;
+		acquirePool = toCompute ? _computeCommandPool : _commandPool;
+		acquireQueue = toCompute ? _computeQueue : _graphicQueue;
+		acquireQueueType = toCompute ? QueueType::Compute : QueueType::Graphic;
+
+		acquireCommands = allocateOneTimeCommands(acquirePool);
+
+		ownershipBarrier.srcAccessMask = 0;
+		ownershipBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		vkCmdPipelineBarrier(acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr, 1, &ownershipBarrier, 0, nullptr);
+		vkEndCommandBuffer(acquireCommands);
+	}
+
+	vkEndCommandBuffer(transferCommands);
+
+	VkSemaphore transferTimeline = getTimeline(QueueType::Transfer);
+	uint64_t transferValue = nextTimelineValue(QueueType::Transfer);
+
+	VkTimelineSemaphoreSubmitInfo transferTimelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	transferTimelineInfo.signalSemaphoreValueCount = 1;
+	transferTimelineInfo.pSignalSemaphoreValues = &transferValue;
+
+	VkSubmitInfo transferSubmit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	transferSubmit.pNext = &transferTimelineInfo;
+	transferSubmit.commandBufferCount = 1;
+	transferSubmit.pCommandBuffers = &transferCommands;
+	transferSubmit.signalSemaphoreCount = 1;
+	transferSubmit.pSignalSemaphores = &transferTimeline;
+
+	VkResult result = vkQueueSubmit(_transferQueue, 1, &transferSubmit, VK_NULL_HANDLE);
+	bool transferSubmitted = result == VK_SUCCESS;
+
+	// The CPU waits for the last queue in the chain, which implies the transfer has finished too
+	QueueType lastQueue = QueueType::Transfer;
+	uint64_t lastValue = transferValue;
+
+	if (result == VK_SUCCESS && acquireCommands)
+	{
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSemaphore acquireTimeline = getTimeline(acquireQueueType);
+		uint64_t acquireValue = nextTimelineValue(acquireQueueType);
+
+		VkTimelineSemaphoreSubmitInfo acquireTimelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+		acquireTimelineInfo.waitSemaphoreValueCount = 1;
+		acquireTimelineInfo.pWaitSemaphoreValues = &transferValue;
+		acquireTimelineInfo.signalSemaphoreValueCount = 1;
+		acquireTimelineInfo.pSignalSemaphoreValues = &acquireValue;
+
+		VkSubmitInfo acquireSubmit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		acquireSubmit.pNext = &acquireTimelineInfo;
+		acquireSubmit.waitSemaphoreCount = 1;
+		acquireSubmit.pWaitSemaphores = &transferTimeline;
+		acquireSubmit.pWaitDstStageMask = &waitStage;
+		acquireSubmit.commandBufferCount = 1;
+		acquireSubmit.pCommandBuffers = &acquireCommands;
+		acquireSubmit.signalSemaphoreCount = 1;
+		acquireSubmit.pSignalSemaphores = &acquireTimeline;
+
+		result = vkQueueSubmit(acquireQueue, 1, &acquireSubmit, VK_NULL_HANDLE);
+		if (result == VK_SUCCESS)
+		{
+			lastQueue = acquireQueueType;
+			lastValue = acquireValue;
+		}
+	}
+
+	// Waits for the transfer even when the acquire submission failed, so the buffers below can be freed
+	if (transferSubmitted)
+	{
+		VkResult waitResult = waitTimeline(lastQueue, lastValue);
+		if (result == VK_SUCCESS) {
+			result = waitResult;
+		}
+	}
+
+	vkFreeCommandBuffers(_device, _transferCommandPool, 1, &transferCommands);
+	if (acquireCommands) {
+		vkFreeCommandBuffers(_device, acquirePool, 1, &acquireCommands);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to copy buffer!");
+	}
+}
+
+void Device::createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, Allocation& allocation,
+	uint32_t dstQueueFamily)
+{
+	VkBuffer stagingBuffer;
+	Allocation stagingAllocation;
+	_allocator->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, stagingBuffer, stagingAllocation);
+
+	std::memcpy(stagingAllocation.mappedData, data, static_cast<size_t>(size));
+	_allocator->flush(stagingAllocation);
+
+	try {
+		_allocator->createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, allocation);
+		copyBuffer(stagingBuffer, buffer, size, dstQueueFamily);
+	}
+	catch (...) {
+		_allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+		throw;
+	}
+
+	_allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+}
+
+VkPhysicalDeviceProperties Device::getProperties()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+
+	return properties;
+}
+
+bool Device::hasUnifiedMemory()
+{
+	if (getProperties().deviceType != VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) {
+		return false;
+	}
+
+	const VkPhysicalDeviceMemoryProperties& memoryProperties = _allocator->getMemoryProperties();
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+			return true;
+		}
+	}
+
+	return false;
+}
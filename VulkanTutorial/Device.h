@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
 
+#include <memory>
 #include <vector>
 #include <map>
 #include <set>
@@ -17,15 +19,19 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-const std::vector<const char*> instanceExtensions = {
-	VK_KHR_SURFACE_EXTENSION_NAME,
-	VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-};
-
+// Only required when presenting to a window
 const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Each has its own timeline semaphore, even when two of them share a VkQueue
+enum class QueueType
+{
+	Graphic,
+	Transfer,
+	Compute
+};
+
 struct SwapChainSupportDetails
 {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -41,39 +47,139 @@ struct QueueFamilyIndices
 	bool graphicFamilyHasValue = false;
 	bool presentFamilyHasValue = false;
 
-	bool isComplete() { return graphicFamilyHasValue && presentFamilyHasValue; }
+	// Fall back to the graphic family when the hardware has no dedicated family
+	int transferFamily;
+	int computeFamily;
+
+	bool transferFamilyIsDedicated = false;
+	bool computeFamilyIsDedicated = false;
+
+	bool isComplete() const { return graphicFamilyHasValue && presentFamilyHasValue; }
 };
 
 class Device
 {
 public:
+	// Passing nullptr creates a headless device without a surface or swapchain support
 	Device(GLFWwindow* window);
 	~Device();
 
+	Device(const Device&) = delete;
+	Device& operator=(const Device&) = delete;
+
 	VkDevice getDevice() { return _device; };
+	VkPhysicalDevice getPhysicalDevice() { return _physicalDevice; }
+	VkSurfaceKHR getSurface() { return _surface; }
+	VkCommandPool getCommandPool() { return _commandPool; }
+	VkQueue getGraphicQueue() { return _graphicQueue; }
+	VkQueue getPresentQueue() { return _presentQueue; }
+	// Same queue as the graphic queue when the family is not dedicated
+	VkQueue getTransferQueue() { return _transferQueue; }
+	VkQueue getComputeQueue() { return _computeQueue; }
+	VkCommandPool getComputeCommandPool() { return _computeCommandPool; }
+
+	// Every submission to a queue signals the next value of its timeline semaphore, so a value stands for
+	// everything submitted up to it. Values are handed out unsynchronized, one thread submits per queue
+	VkSemaphore getTimeline(QueueType queue) const { return _timelines[static_cast<int>(queue)]; }
+	uint64_t nextTimelineValue(QueueType queue) { return ++_timelineValues[static_cast<int>(queue)]; }
+	uint64_t getLastTimelineValue(QueueType queue) const { return _timelineValues[static_cast<int>(queue)]; }
+	// Blocks the CPU until the queue's timeline reaches value, 0 returns at once
+	VkResult waitTimeline(QueueType queue, uint64_t value);
+	bool isTimelineReached(QueueType queue, uint64_t value);
+
+	bool isHeadless() const { return _headless; }
+
+	VkPhysicalDeviceProperties getProperties();
+	// Integrated GPUs share memory with the CPU, so writing straight into device-local memory beats staging copies
+	bool hasUnifiedMemory();
+
+	// Optional features are enabled whenever the device supports them, check here before relying on one
+	const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return _enabledFeatures; }
+	const VkPhysicalDeviceVulkan12Features& getEnabledVulkan12Features() const { return _enabledVulkan12Features; }
+
+	// VK_KHR_dynamic_rendering is enabled whenever the device supports it. Vulkan headers older than 1.2.197,
+	// like those of the pinned SDK, do not declare it, builds against them always use the render pass
+#ifdef VK_KHR_dynamic_rendering
+	bool supportsDynamicRendering() const { return _vkCmdBeginRenderingKHR != nullptr; }
+	void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo) { _vkCmdBeginRenderingKHR(commandBuffer, &renderingInfo); }
+	void cmdEndRendering(VkCommandBuffer commandBuffer) { _vkCmdEndRenderingKHR(commandBuffer); }
+#else
+	bool supportsDynamicRendering() const { return false; }
+#endif
+
+	// Found once while picking the physical device
+	const QueueFamilyIndices& getQueueFamilies() const { return _queueFamilies; }
+	SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(_physicalDevice); }
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	// First candidate whose given tiling supports the features
+	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+	// Buffers and images should get their memory from here instead of vkAllocateMemory
+	MemoryAllocator& getAllocator() { return *_allocator; }
+
+	// Blocking one-off submissions on the graphic queue for work at load time
+	VkCommandBuffer beginSingleTimeCommands();
+	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+	// Copies on the transfer queue and, for a different family, transfers ownership of dstBuffer
+	// to dstQueueFamily. VK_QUEUE_FAMILY_IGNORED stands for the graphic family
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+	// Uploads data once through a staging buffer, TRANSFER_DST is added to the usage
+	void createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, Allocation& allocation,
+		uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
 private:
+	bool _headless;
+
 	VkInstance _instance;
 	VkSurfaceKHR _surface;
 	VkPhysicalDevice _physicalDevice;
 	VkDevice _device;
+	QueueFamilyIndices _queueFamilies;
+
+	VkPhysicalDeviceFeatures _enabledFeatures;
+	VkPhysicalDeviceVulkan12Features _enabledVulkan12Features;
+
+	// Extension entry points, null when the extension is not enabled
+#ifdef VK_KHR_dynamic_rendering
+	PFN_vkCmdBeginRenderingKHR _vkCmdBeginRenderingKHR = nullptr;
+	PFN_vkCmdEndRenderingKHR _vkCmdEndRenderingKHR = nullptr;
+#endif
 
 	VkCommandPool _commandPool;
+	VkCommandPool _transferCommandPool;
+	VkCommandPool _computeCommandPool;
+
+	std::unique_ptr<MemoryAllocator> _allocator;
 
 	VkQueue _graphicQueue;
 	VkQueue _presentQueue;
+	VkQueue _transferQueue;
+	VkQueue _computeQueue;
+
+	// Indexed by QueueType
+	VkSemaphore _timelines[3] = {};
+	uint64_t _timelineValues[3] = {};
 
 	void createInstance();
 	void createSurface(GLFWwindow* window);
 	void pickPhysicalDevice();
 	void createLogicalDevice();
 	void createCommandPool();
+	VkCommandPool createCommandPool(uint32_t queueFamily, VkCommandPoolCreateFlags flags);
+	void createTimelines();
+	void createAllocator();
 
 	// Helper function for picking right pysical device
 	int ratePhysicalDeviceSuitability(VkPhysicalDevice physicalDevice);
-	bool isPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice);
+	bool isPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice, const QueueFamilyIndices& indices);
 
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice);
+	VkCommandBuffer allocateOneTimeCommands(VkCommandPool commandPool);
+	std::vector<const char*> getRequiredInstanceExtensions();
+	std::vector<const char*> getRequiredDeviceExtensions();
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+	bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice physicalDevice);
 };
 
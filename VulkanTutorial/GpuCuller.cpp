@@ -0,0 +1,287 @@
+#include "GpuCuller.h"
+
+#include "StartupTracer.h"
+
+#include <stdexcept>
+
+static const uint32_t WORKGROUP_SIZE = 64;
+
+GpuCuller::GpuCuller(Device& device, Pipeline& pipelineFactory, uint32_t framesInFlight, const std::vector<Object>& objects, uint32_t vertexCount,
+	bool asyncCompute)
+	: _device{ device }, _objectCount{ static_cast<uint32_t>(objects.size()) }, _vertexCount{ vertexCount }
+{
+	StartupTracer::Scope scope("GpuCuller::GpuCuller");
+
+	QueueFamilyIndices indices = _device.getQueueFamilies();
+	_async = asyncCompute && indices.computeFamilyIsDedicated;
+	_computeFamily = indices.computeFamily;
+	_graphicFamily = indices.graphicFamily;
+
+	if (!_device.getEnabledVulkan12Features().drawIndirectCount || !_device.getEnabledFeatures().drawIndirectFirstInstance) {
+		throw std::runtime_error("GPU culling requires drawIndirectCount and drawIndirectFirstInstance!");
+	}
+	if (objects.empty()) {
+		throw std::runtime_error("GPU culling needs at least one object!");
+	}
+
+	createBuffers(framesInFlight, objects);
+	createDescriptorSets(framesInFlight);
+	createPipeline(pipelineFactory);
+	if (_async) {
+		createComputeCommands(framesInFlight);
+	}
+}
+
+GpuCuller::~GpuCuller()
+{
+	if (!_computeCommandBuffers.empty()) {
+		vkFreeCommandBuffers(_device.getDevice(), _device.getComputeCommandPool(),
+			static_cast<uint32_t>(_computeCommandBuffers.size()), _computeCommandBuffers.data());
+	}
+
+	vkDestroyPipelineLayout(_device.getDevice(), _pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(_device.getDevice(), _descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(_device.getDevice(), _descriptorSetLayout, nullptr);
+
+	MemoryAllocator& allocator = _device.getAllocator();
+	for (size_t i = 0; i < _drawCommandBuffers.size(); ++i)
+	{
+		allocator.destroyBuffer(_drawCountBuffers[i], _drawCountAllocations[i]);
+		allocator.destroyBuffer(_drawCommandBuffers[i], _drawCommandAllocations[i]);
+	}
+	allocator.destroyBuffer(_objectBuffer, _objectAllocation);
+}
+
+void GpuCuller::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float view[4])
+{
+	recordDispatch(commandBuffer, frameIndex, view);
+
+	VkMemoryBarrier cullBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+uint64_t GpuCuller::cullAsync(uint32_t frameIndex, const float view[4])
+{
+	VkCommandBuffer commandBuffer = _computeCommandBuffers[frameIndex];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording culling command buffer!");
+	}
+
+	// The previous contents are discarded, so the compute queue writes without acquiring the buffers first
+	recordDispatch(commandBuffer, frameIndex, view);
+	recordOwnershipTransfer(commandBuffer, frameIndex, true);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record culling command buffer!");
+	}
+
+	VkSemaphore timeline = _device.getTimeline(QueueType::Compute);
+	uint64_t signalValue = _device.nextTimelineValue(QueueType::Compute);
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline;
+
+	if (vkQueueSubmit(_device.getComputeQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit culling command buffer!");
+	}
+
+	return signalValue;
+}
+
+void GpuCuller::acquire(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	recordOwnershipTransfer(commandBuffer, frameIndex, false);
+}
+
+void GpuCuller::recordOwnershipTransfer(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool release)
+{
+	VkBufferMemoryBarrier barriers[2] = {};
+	VkBuffer buffers[2] = { _drawCommandBuffers[frameIndex], _drawCountBuffers[frameIndex] };
+	for (int i = 0; i < 2; ++i)
+	{
+		barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barriers[i].srcAccessMask = release ? VK_ACCESS_SHADER_WRITE_BIT : 0;
+		barriers[i].dstAccessMask = release ? 0 : VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		barriers[i].srcQueueFamilyIndex = _computeFamily;
+		barriers[i].dstQueueFamilyIndex = _graphicFamily;
+		barriers[i].buffer = buffers[i];
+		barriers[i].size = VK_WHOLE_SIZE;
+	}
+
+	VkPipelineStageFlags srcStage = release ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkPipelineStageFlags dstStage = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 2, barriers, 0, nullptr);
+}
+
+void GpuCuller::recordDispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float view[4])
+{
+	vkCmdFillBuffer(commandBuffer, _drawCountBuffers[frameIndex], 0, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier clearBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	PushConstants pushConstants;
+	for (int i = 0; i < 4; ++i) {
+		pushConstants.view[i] = view[i];
+	}
+	pushConstants.objectCount = _objectCount;
+	pushConstants.vertexCount = _vertexCount;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &_descriptorSets[frameIndex], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (_objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+void GpuCuller::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	vkCmdDrawIndirectCount(commandBuffer, _drawCommandBuffers[frameIndex], 0, _drawCountBuffers[frameIndex], 0,
+		_objectCount, sizeof(VkDrawIndirectCommand));
+}
+
+void GpuCuller::createBuffers(uint32_t framesInFlight, const std::vector<Object>& objects)
+{
+	// Only ever read by the culling, so the compute family keeps it for good
+	_device.createDeviceLocalBuffer(objects.data(), sizeof(Object) * objects.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		_objectBuffer, _objectAllocation, _async ? _computeFamily : VK_QUEUE_FAMILY_IGNORED);
+
+	_drawCommandBuffers.resize(framesInFlight);
+	_drawCommandAllocations.resize(framesInFlight);
+	_drawCountBuffers.resize(framesInFlight);
+	_drawCountAllocations.resize(framesInFlight);
+
+	MemoryAllocator& allocator = _device.getAllocator();
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		allocator.createBuffer(sizeof(VkDrawIndirectCommand) * _objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _drawCommandBuffers[i], _drawCommandAllocations[i]);
+		allocator.createBuffer(sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _drawCountBuffers[i], _drawCountAllocations[i]);
+	}
+}
+
+void GpuCuller::createDescriptorSets(uint32_t framesInFlight)
+{
+	VkDescriptorSetLayoutBinding bindings[3] = {};
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(_device.getDevice(), &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 3 * framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(_device.getDevice(), &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(framesInFlight, _descriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocateInfo.descriptorPool = _descriptorPool;
+	allocateInfo.descriptorSetCount = framesInFlight;
+	allocateInfo.pSetLayouts = layouts.data();
+
+	_descriptorSets.resize(framesInFlight);
+	if (vkAllocateDescriptorSets(_device.getDevice(), &allocateInfo, _descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate culling descriptor sets!");
+	}
+
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		VkDescriptorBufferInfo bufferInfos[3] = {};
+		bufferInfos[0].buffer = _objectBuffer;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = _drawCommandBuffers[i];
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = _drawCountBuffers[i];
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet writes[3] = {};
+		for (uint32_t binding = 0; binding < 3; ++binding)
+		{
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = _descriptorSets[i];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[binding].pBufferInfo = &bufferInfos[binding];
+		}
+
+		vkUpdateDescriptorSets(_device.getDevice(), 3, writes, 0, nullptr);
+	}
+}
+
+void GpuCuller::createPipeline(Pipeline& pipelineFactory)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &_descriptorSetLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(_device.getDevice(), &layoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+	_pipeline = pipelineFactory.createComputePipeline("shaders/cull.spv", _pipelineLayout).get();
+}
+
+void GpuCuller::createComputeCommands(uint32_t framesInFlight)
+{
+	_computeCommandBuffers.resize(framesInFlight);
+
+	VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocateInfo.commandPool = _device.getComputeCommandPool();
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = framesInFlight;
+
+	if (vkAllocateCommandBuffers(_device.getDevice(), &allocateInfo, _computeCommandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate culling command buffers!");
+	}
+}
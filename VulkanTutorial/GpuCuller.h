@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Device.h"
+#include "Pipeline.h"
+
+#include <vector>
+
+// GPU-driven drawing. A compute pre-pass frustum culls every object and compacts the
+// survivors into an indirect buffer, which the render pass consumes with vkCmdDrawIndirectCount
+class GpuCuller
+{
+public:
+	// Matches the std430 layout in cull.comp
+	struct Object
+	{
+		// Center x, center y, radius, unused
+		float bounds[4];
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t padding[2];
+	};
+
+	// Throws when the device lacks drawIndirectCount or drawIndirectFirstInstance. asyncCompute moves
+	// the culling to the dedicated compute queue and is ignored when the device has none
+	GpuCuller(Device& device, Pipeline& pipelineFactory, uint32_t framesInFlight, const std::vector<Object>& objects, uint32_t vertexCount,
+		bool asyncCompute = false);
+	~GpuCuller();
+
+	GpuCuller(const GpuCuller&) = delete;
+	GpuCuller& operator=(const GpuCuller&) = delete;
+
+	// Must be recorded outside a render pass. view is offset x, offset y, zoom, unused
+	void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float view[4]);
+	// Must be recorded inside the render pass with the graphics pipeline and vertex buffers bound
+	void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Async mode only. Submits the culling of the frame to the compute queue and returns the compute
+	// timeline value the graphic submission waits for at VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT
+	uint64_t cullAsync(uint32_t frameIndex, const float view[4]);
+	// Async mode only. Takes ownership of the culling results back on the graphic queue, outside a render pass
+	void acquire(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	uint32_t getObjectCount() const { return _objectCount; }
+	bool isAsync() const { return _async; }
+
+private:
+	struct PushConstants
+	{
+		float view[4];
+		uint32_t objectCount;
+		uint32_t vertexCount;
+	};
+
+	Device& _device;
+	uint32_t _objectCount;
+	uint32_t _vertexCount;
+
+	bool _async;
+	uint32_t _computeFamily;
+	uint32_t _graphicFamily;
+	// Async mode only, per frame in flight. The graphic frame wait also covers them because
+	// the graphic submission waits for the culling
+	std::vector<VkCommandBuffer> _computeCommandBuffers;
+
+	VkBuffer _objectBuffer;
+	Allocation _objectAllocation;
+
+	// Per frame in flight, the GPU may still draw from the previous frame's commands
+	std::vector<VkBuffer> _drawCommandBuffers;
+	std::vector<Allocation> _drawCommandAllocations;
+	std::vector<VkBuffer> _drawCountBuffers;
+	std::vector<Allocation> _drawCountAllocations;
+
+	VkDescriptorSetLayout _descriptorSetLayout;
+	VkDescriptorPool _descriptorPool;
+	std::vector<VkDescriptorSet> _descriptorSets;
+
+	VkPipelineLayout _pipelineLayout;
+	// Owned by the pipeline factory
+	VkPipeline _pipeline;
+
+	void createBuffers(uint32_t framesInFlight, const std::vector<Object>& objects);
+	void createDescriptorSets(uint32_t framesInFlight);
+	void createPipeline(Pipeline& pipelineFactory);
+	void createComputeCommands(uint32_t framesInFlight);
+
+	void recordDispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex, const float view[4]);
+	// Release on the compute queue and acquire on the graphic queue use the same barriers
+	void recordOwnershipTransfer(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool release);
+};
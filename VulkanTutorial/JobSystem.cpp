@@ -0,0 +1,290 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Set on every worker thread, the creating thread included, for as long as its system exists
+static thread_local JobSystem* currentSystem = nullptr;
+static thread_local uint32_t currentWorkerIndex = 0;
+static thread_local uint32_t randomState = 0;
+
+// Spins spent looking for work before an idle worker goes to sleep
+static const uint32_t IDLE_SPINS = 64;
+
+static uint32_t nextRandom()
+{
+	// xorshift32, only used to spread thieves over the victims
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	if (currentSystem != nullptr) {
+		throw std::runtime_error("Only one job system per thread is supported!");
+	}
+
+	_deques.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		_deques.push_back(std::make_unique<WorkStealingDeque<Task>>(DEQUE_CAPACITY));
+	}
+
+	currentSystem = this;
+	currentWorkerIndex = 0;
+	randomState = 0x9E3779B9u;
+
+	_workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; ++i) {
+		_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stopping = true;
+	}
+	_wakeCondition.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+
+	// Jobs nobody waited for are dropped
+	for (auto& deque : _deques)
+	{
+		while (Task* task = deque->pop()) {
+			delete task;
+		}
+	}
+
+	currentSystem = nullptr;
+}
+
+void JobSystem::run(JobCounter& counter, Job job)
+{
+	uint32_t workerIndex = currentWorker();
+
+	Task* task = new Task{ std::move(job), &counter };
+	counter._pending.fetch_add(1, std::memory_order_relaxed);
+
+	// A full deque means the workers are far behind already, running the job right away keeps the caller busy instead
+	if (!_deques[workerIndex]->push(task))
+	{
+		execute(task);
+		return;
+	}
+
+	_pushCount.fetch_add(1);
+	if (_sleepingCount.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_wakeCondition.notify_one();
+	}
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	uint32_t workerIndex = currentWorker();
+
+	while (!counter.isDone())
+	{
+		Task* task = findTask(workerIndex);
+		if (task) {
+			execute(task);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter._errorMutex);
+		std::swap(error, counter._error);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::parallelFor(uint32_t itemCount, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t count)>& function)
+{
+	if (itemCount == 0) {
+		return;
+	}
+	batchSize = std::max(1u, batchSize);
+
+	// A single batch is not worth the scheduling
+	if (itemCount <= batchSize)
+	{
+		function(0, itemCount);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint32_t first = 0; first < itemCount; first += batchSize)
+	{
+		uint32_t count = std::min(batchSize, itemCount - first);
+		run(counter, [&function, first, count]() { function(first, count); });
+	}
+	wait(counter);
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+	currentSystem = this;
+	currentWorkerIndex = workerIndex;
+	randomState = 0x9E3779B9u * (workerIndex + 1);
+
+	while (true)
+	{
+		uint64_t seenPushes = _pushCount.load();
+
+		Task* task = findTask(workerIndex);
+		for (uint32_t spin = 0; !task && spin < IDLE_SPINS; ++spin)
+		{
+			std::this_thread::yield();
+			task = findTask(workerIndex);
+		}
+
+		if (task)
+		{
+			execute(task);
+			continue;
+		}
+
+		// A push after seenPushes was read either shows up in the predicate or sees this worker sleeping and notifies it
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		if (_stopping) {
+			return;
+		}
+		_sleepingCount.fetch_add(1);
+		_wakeCondition.wait(lock, [&]() { return _stopping || _pushCount.load() != seenPushes; });
+		_sleepingCount.fetch_sub(1);
+	}
+}
+
+JobSystem::Task* JobSystem::findTask(uint32_t workerIndex)
+{
+	if (Task* task = _deques[workerIndex]->pop()) {
+		return task;
+	}
+
+	uint32_t dequeCount = static_cast<uint32_t>(_deques.size());
+	uint32_t firstVictim = nextRandom() % dequeCount;
+	for (uint32_t i = 0; i < dequeCount; ++i)
+	{
+		uint32_t victim = (firstVictim + i) % dequeCount;
+		if (victim == workerIndex) {
+			continue;
+		}
+		if (Task* task = _deques[victim]->steal()) {
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(Task* task)
+{
+	JobCounter* counter = task->counter;
+
+	try {
+		task->job();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(counter->_errorMutex);
+		if (!counter->_error) {
+			counter->_error = std::current_exception();
+		}
+	}
+
+	delete task;
+	counter->_pending.fetch_sub(1, std::memory_order_release);
+}
+
+uint32_t JobSystem::currentWorker() const
+{
+	if (currentSystem != this) {
+		throw std::runtime_error("Jobs can only be run and waited on from the job system's own threads!");
+	}
+	return currentWorkerIndex;
+}
+
+JobGraph::NodeId JobGraph::add(JobSystem::Job job, const std::vector<NodeId>& dependencies)
+{
+	NodeId id = static_cast<NodeId>(_nodes.size());
+
+	for (NodeId dependency : dependencies)
+	{
+		if (dependency >= id) {
+			throw std::runtime_error("Job graph dependencies must be added before their dependents!");
+		}
+		_nodes[dependency].dependents.push_back(id);
+	}
+
+	Node node;
+	node.job = std::move(job);
+	node.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	_nodes.push_back(std::move(node));
+
+	return id;
+}
+
+void JobGraph::clear()
+{
+	_nodes.clear();
+}
+
+void JobGraph::run(JobSystem& jobSystem)
+{
+	_remaining.reset(new std::atomic<uint32_t>[_nodes.size()]);
+	for (size_t i = 0; i < _nodes.size(); ++i) {
+		_remaining[i].store(_nodes[i].dependencyCount, std::memory_order_relaxed);
+	}
+
+	JobCounter counter;
+	for (NodeId id = 0; id < _nodes.size(); ++id)
+	{
+		if (_nodes[id].dependencyCount == 0) {
+			start(jobSystem, counter, id);
+		}
+	}
+	jobSystem.wait(counter);
+}
+
+void JobGraph::start(JobSystem& jobSystem, JobCounter& counter, NodeId id)
+{
+	jobSystem.run(counter, [this, &jobSystem, &counter, id]()
+	{
+		// Dependents are released even when the job throws, so the graph always drains and the wait returns
+		std::exception_ptr error;
+		try {
+			_nodes[id].job();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		for (NodeId dependent : _nodes[id].dependents)
+		{
+			// The counter is raised by start before this job lowers it, so it never drops to zero early
+			if (_remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				start(jobSystem, counter, dependent);
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	});
+}
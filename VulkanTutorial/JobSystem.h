@@ -0,0 +1,119 @@
+#pragma once
+
+#include "WorkStealingDeque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks a group of jobs. Waiting on it runs other jobs until every job of the group has finished
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> _pending{ 0 };
+	// First exception thrown by a job of the group, rethrown by JobSystem::wait
+	std::mutex _errorMutex;
+	std::exception_ptr _error;
+};
+
+// Work-stealing scheduler. Every worker owns a deque it pushes to and pops from without locks, idle workers
+// steal from the others and sleep once there is nothing left. The thread creating the system is worker 0,
+// it runs jobs only while waiting on a counter. Jobs may add and wait on further jobs themselves
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	// Zero picks one worker per hardware core, the creating thread included
+	explicit JobSystem(uint32_t threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Adds a job to the group of counter. Only from worker threads, that is the creating thread or a job
+	void run(JobCounter& counter, Job job);
+	// Runs jobs until the group has finished, then rethrows the first exception one of them threw
+	void wait(JobCounter& counter);
+
+	// Calls function(first, count) for batches of at most batchSize items across all workers and waits for them
+	void parallelFor(uint32_t itemCount, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t count)>& function);
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(_deques.size()); }
+
+private:
+	static const uint32_t DEQUE_CAPACITY = 4096;
+
+	struct Task
+	{
+		Job job;
+		JobCounter* counter;
+	};
+
+	std::vector<std::unique_ptr<WorkStealingDeque<Task>>> _deques;
+	std::vector<std::thread> _workers;
+
+	// Bumped by every push, sleeping workers wake when it changed since they last looked for work
+	std::atomic<uint64_t> _pushCount{ 0 };
+	std::atomic<uint32_t> _sleepingCount{ 0 };
+	std::mutex _sleepMutex;
+	std::condition_variable _wakeCondition;
+	bool _stopping = false;
+
+	void workerLoop(uint32_t workerIndex);
+	// Own deque first, then the others starting at a random victim
+	Task* findTask(uint32_t workerIndex);
+	void execute(Task* task);
+	uint32_t currentWorker() const;
+};
+
+// Jobs with dependencies between them, rebuilt every frame. Each node is started as soon as
+// all nodes it depends on have finished, independent nodes run in parallel
+class JobGraph
+{
+public:
+	using NodeId = uint32_t;
+
+	JobGraph() = default;
+
+	JobGraph(const JobGraph&) = delete;
+	JobGraph& operator=(const JobGraph&) = delete;
+
+	// Dependencies must have been added before
+	NodeId add(JobSystem::Job job, const std::vector<NodeId>& dependencies = {});
+	void clear();
+
+	// Blocks until every node has run, rethrowing the first exception. A throwing node still releases its dependents
+	void run(JobSystem& jobSystem);
+
+	size_t size() const { return _nodes.size(); }
+
+private:
+	struct Node
+	{
+		JobSystem::Job job;
+		uint32_t dependencyCount = 0;
+		std::vector<NodeId> dependents;
+	};
+
+	std::vector<Node> _nodes;
+	// Dependencies left per node during run
+	std::unique_ptr<std::atomic<uint32_t>[]> _remaining;
+
+	void start(JobSystem& jobSystem, JobCounter& counter, NodeId id);
+};
@@ -0,0 +1,172 @@
+#include "JobSystemBenchmark.h"
+
+#include "JobSystem.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Every measurement is repeated and the fastest run is reported, the others mostly measure the OS scheduler
+static const int REPETITIONS = 5;
+static const uint32_t EMPTY_JOB_COUNT = 100000;
+static const uint32_t GRAPH_LAYERS = 16;
+static const uint32_t GRAPH_WIDTH = 64;
+static const uint32_t WORKLOAD_ITEMS = 1u << 21;
+static const uint32_t WORKLOAD_BATCH = 4096;
+
+template<typename Function>
+static double bestNanoseconds(Function function)
+{
+	double best = 0.0;
+	for (int i = 0; i < REPETITIONS; ++i)
+	{
+		auto start = Clock::now();
+		function();
+		double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		if (i == 0 || nanoseconds < best) {
+			best = nanoseconds;
+		}
+	}
+	return best;
+}
+
+// Splits [first, first + count) in halves until it fits one job, so jobs are pushed from every worker
+static void spawnTree(JobSystem& jobSystem, JobCounter& counter, uint32_t first, uint32_t count)
+{
+	while (count > 1)
+	{
+		uint32_t half = count / 2;
+		jobSystem.run(counter, [&jobSystem, &counter, first, half]() { spawnTree(jobSystem, counter, first, half); });
+		first += half;
+		count -= half;
+	}
+}
+
+// Enough arithmetic per item that a batch outweighs its scheduling
+static float workItem(uint32_t index)
+{
+	uint32_t state = index * 2654435761u + 1;
+	float sum = 0.0f;
+	for (int i = 0; i < 64; ++i)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		sum = sum * 0.5f + static_cast<float>(state & 0xFFFF);
+	}
+	return sum;
+}
+
+static void benchmarkOverhead(std::ostream& out, uint32_t threadCount)
+{
+	JobSystem jobSystem(threadCount);
+
+	double flat = bestNanoseconds([&]()
+	{
+		JobCounter counter;
+		for (uint32_t i = 0; i < EMPTY_JOB_COUNT; ++i) {
+			jobSystem.run(counter, []() {});
+		}
+		jobSystem.wait(counter);
+	});
+
+	double tree = bestNanoseconds([&]()
+	{
+		JobCounter counter;
+		spawnTree(jobSystem, counter, 0, EMPTY_JOB_COUNT);
+		jobSystem.wait(counter);
+	});
+
+	double graph = bestNanoseconds([&]()
+	{
+		// Every node waits on two nodes of the layer before it
+		JobGraph jobGraph;
+		std::vector<JobGraph::NodeId> previous, current;
+		for (uint32_t layer = 0; layer < GRAPH_LAYERS; ++layer)
+		{
+			current.clear();
+			for (uint32_t i = 0; i < GRAPH_WIDTH; ++i)
+			{
+				if (layer == 0) {
+					current.push_back(jobGraph.add([]() {}));
+				}
+				else {
+					current.push_back(jobGraph.add([]() {}, { previous[i], previous[(i + 1) % GRAPH_WIDTH] }));
+				}
+			}
+			std::swap(previous, current);
+		}
+		jobGraph.run(jobSystem);
+	});
+
+	ThreadPool threadPool(threadCount);
+	double pool = bestNanoseconds([&]()
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(EMPTY_JOB_COUNT);
+		for (uint32_t i = 0; i < EMPTY_JOB_COUNT; ++i) {
+			futures.push_back(threadPool.submit([]() {}));
+		}
+		for (std::future<void>& future : futures) {
+			future.wait();
+		}
+	});
+
+	out << threadCount << " threads: " << flat / EMPTY_JOB_COUNT << " ns/job pushed by one thread, "
+		<< tree / EMPTY_JOB_COUNT << " ns/job pushed by all, "
+		<< graph / (GRAPH_LAYERS * GRAPH_WIDTH) << " ns/graph node (graph built in the loop), "
+		<< pool / EMPTY_JOB_COUNT << " ns/task on the shared-queue thread pool" << std::endl;
+}
+
+static double benchmarkWorkload(uint32_t threadCount, std::vector<float>& results)
+{
+	JobSystem jobSystem(threadCount);
+
+	return bestNanoseconds([&]()
+	{
+		jobSystem.parallelFor(WORKLOAD_ITEMS, WORKLOAD_BATCH, [&](uint32_t first, uint32_t count)
+		{
+			for (uint32_t i = first; i < first + count; ++i) {
+				results[i] = workItem(i);
+			}
+		});
+	});
+}
+
+void runJobSystemBenchmark(std::ostream& out, uint32_t maxThreads)
+{
+	if (maxThreads == 0) {
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Powers of two up to the maximum, the maximum itself included
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < maxThreads; threadCount *= 2) {
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreads);
+
+	out << "Scheduling overhead, " << EMPTY_JOB_COUNT << " empty jobs" << std::endl;
+	for (uint32_t threadCount : threadCounts) {
+		benchmarkOverhead(out, threadCount);
+	}
+
+	out << "Throughput, " << WORKLOAD_ITEMS << " items in batches of " << WORKLOAD_BATCH << std::endl;
+	std::vector<float> results(WORKLOAD_ITEMS);
+	double baseline = 0.0;
+	for (uint32_t threadCount : threadCounts)
+	{
+		double nanoseconds = benchmarkWorkload(threadCount, results);
+		if (threadCount == 1) {
+			baseline = nanoseconds;
+		}
+
+		double speedup = baseline / nanoseconds;
+		out << threadCount << " threads: " << nanoseconds / 1e6 << " ms, " << WORKLOAD_ITEMS / (nanoseconds / 1e9) / 1e6 << " M items/s, "
+			<< speedup << "x speedup, " << speedup / threadCount * 100.0 << "% efficiency" << std::endl;
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Micro-benchmarks of the job system: scheduling overhead per empty job, job graph overhead per node and
+// how a fixed CPU workload scales from one thread up to maxThreads (0 for one per core).
+// The shared-queue ThreadPool is measured alongside as the baseline
+void runJobSystemBenchmark(std::ostream& out, uint32_t maxThreads = 0);
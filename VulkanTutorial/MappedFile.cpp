@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile MappedFile::map(const std::string& filePath)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open file: " + filePath);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get file size: " + filePath);
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mappingHandle == nullptr) {
+		throw std::runtime_error("Failed to map file: " + filePath);
+	}
+
+	void* mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mappingHandle);
+	if (mapping == nullptr) {
+		throw std::runtime_error("Failed to map file: " + filePath);
+	}
+
+	size_t size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = open(filePath.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("Failed to open file: " + filePath);
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(file);
+		throw std::runtime_error("Failed to get file size: " + filePath);
+	}
+
+	size_t size = static_cast<size_t>(fileStat.st_size);
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("Failed to map file: " + filePath);
+	}
+#endif
+
+	return MappedFile(mapping, size);
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : _data{ other._data }, _size{ other._size }
+{
+	other._data = nullptr;
+	other._size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		unmap();
+		_data = other._data;
+		_size = other._size;
+		other._data = nullptr;
+		other._size = 0;
+	}
+	return *this;
+}
+
+void MappedFile::unmap()
+{
+	if (_data == nullptr) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+#else
+	munmap(_data, _size);
+#endif
+
+	_data = nullptr;
+	_size = 0;
+}
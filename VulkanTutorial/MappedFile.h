@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read in by the OS on first access and can be
+// dropped again under memory pressure, so large files cost address space rather than memory
+class MappedFile
+{
+public:
+	// Throws when the file is missing or empty
+	static MappedFile map(const std::string& filePath);
+
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const void* data() const { return _data; }
+	size_t size() const { return _size; }
+	bool isMapped() const { return _data != nullptr; }
+
+private:
+	MappedFile(void* data, size_t size) : _data{ data }, _size{ size } {}
+
+	void* _data = nullptr;
+	size_t _size = 0;
+
+	void unmap();
+};
@@ -0,0 +1,408 @@
+#include "MemoryAllocator.h"
+
+#include "Alignment.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+struct MemoryBlock
+{
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	void* mappedData;
+	uint32_t memoryTypeIndex;
+	ResourceKind kind;
+
+	// Free ranges keyed by offset, neighbours are merged on free
+	std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+	VkDeviceSize usedBytes = 0;
+	uint32_t allocationCount = 0;
+
+	bool allocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize& offset);
+	void free(VkDeviceSize offset, VkDeviceSize allocationSize);
+};
+
+bool MemoryBlock::allocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	// Best fit keeps large ranges intact for large resources
+	auto bestRange = freeRanges.end();
+	VkDeviceSize bestWaste = ~0ull;
+
+	for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range)
+	{
+		VkDeviceSize alignedOffset = alignUp(range->first, alignment);
+		VkDeviceSize rangeEnd = range->first + range->second;
+		if (alignedOffset + allocationSize > rangeEnd) {
+			continue;
+		}
+
+		// Tightest fit by the remainder behind. The alignment padding in front is not counted, it stays free as a range of its own
+		VkDeviceSize waste = rangeEnd - (alignedOffset + allocationSize);
+		if (waste < bestWaste)
+		{
+			bestRange = range;
+			bestWaste = waste;
+		}
+	}
+
+	if (bestRange == freeRanges.end()) {
+		return false;
+	}
+
+	VkDeviceSize rangeOffset = bestRange->first;
+	VkDeviceSize rangeEnd = bestRange->first + bestRange->second;
+	offset = alignUp(rangeOffset, alignment);
+	freeRanges.erase(bestRange);
+
+	// Alignment padding in front and the tail stay available
+	if (offset > rangeOffset) {
+		freeRanges[rangeOffset] = offset - rangeOffset;
+	}
+	if (offset + allocationSize < rangeEnd) {
+		freeRanges[offset + allocationSize] = rangeEnd - (offset + allocationSize);
+	}
+
+	usedBytes += allocationSize;
+	++allocationCount;
+
+	return true;
+}
+
+void MemoryBlock::free(VkDeviceSize offset, VkDeviceSize allocationSize)
+{
+	auto range = freeRanges.emplace(offset, allocationSize).first;
+
+	auto next = std::next(range);
+	if (next != freeRanges.end() && range->first + range->second == next->first)
+	{
+		range->second += next->second;
+		freeRanges.erase(next);
+	}
+
+	if (range != freeRanges.begin())
+	{
+		auto previous = std::prev(range);
+		if (previous->first + previous->second == range->first)
+		{
+			previous->second += range->second;
+			freeRanges.erase(range);
+		}
+	}
+
+	usedBytes -= allocationSize;
+	--allocationCount;
+}
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+	: _device{ device }, _blockSize{ blockSize }
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	_maxDeviceMemoryCount = properties.limits.maxMemoryAllocationCount;
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& memoryType : _blocks)
+	{
+		for (auto& blocks : memoryType)
+		{
+			for (auto& block : blocks) {
+				freeDeviceMemory(block->memory);
+			}
+		}
+	}
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+	uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+	VkDeviceSize alignment = getRequiredAlignment(requirements, memoryTypeIndex);
+	VkDeviceSize size = alignUp(requirements.size, alignment);
+	VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+	Allocation allocation;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.size = size;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Resources bigger than half a block would waste most of it, they get their own memory
+	if (size > blockSize / 2)
+	{
+		allocation.memory = allocateDeviceMemory(size, memoryTypeIndex, &allocation.mappedData);
+		allocation.isDedicated = true;
+		++_dedicatedAllocationCount;
+		_dedicatedBytes += size;
+		return allocation;
+	}
+
+	std::vector<std::unique_ptr<MemoryBlock>>& blocks = _blocks[memoryTypeIndex][static_cast<int>(kind)];
+
+	MemoryBlock* target = nullptr;
+	for (auto& block : blocks)
+	{
+		if (block->allocate(size, alignment, allocation.offset))
+		{
+			target = block.get();
+			break;
+		}
+	}
+
+	if (target == nullptr)
+	{
+		std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+		block->memory = allocateDeviceMemory(blockSize, memoryTypeIndex, &block->mappedData);
+		block->size = blockSize;
+		block->memoryTypeIndex = memoryTypeIndex;
+		block->kind = kind;
+		block->freeRanges[0] = blockSize;
+
+		block->allocate(size, alignment, allocation.offset);
+		target = block.get();
+		blocks.push_back(std::move(block));
+	}
+
+	allocation.memory = target->memory;
+	allocation.mappedData = target->mappedData ? static_cast<char*>(target->mappedData) + allocation.offset : nullptr;
+	allocation.block = target;
+
+	return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (allocation.isDedicated)
+	{
+		freeDeviceMemory(allocation.memory);
+		--_dedicatedAllocationCount;
+		_dedicatedBytes -= allocation.size;
+	}
+	else if (allocation.block != nullptr)
+	{
+		MemoryBlock* block = allocation.block;
+		block->free(allocation.offset, allocation.size);
+
+		// One empty block per memory type is kept around to avoid allocation churn
+		std::vector<std::unique_ptr<MemoryBlock>>& blocks = _blocks[block->memoryTypeIndex][static_cast<int>(block->kind)];
+		if (block->allocationCount == 0 && blocks.size() > 1)
+		{
+			freeDeviceMemory(block->memory);
+			blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+				[block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; }));
+		}
+	}
+
+	allocation = Allocation{};
+}
+
+void MemoryAllocator::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation)
+{
+	VkBufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	createInfo.size = size;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(_device, &createInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create buffer!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(_device, buffer, &memoryRequirements);
+
+	allocation = allocate(memoryRequirements, properties, ResourceKind::Linear);
+
+	if (vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to bind buffer memory!");
+	}
+}
+
+void MemoryAllocator::destroyBuffer(VkBuffer buffer, Allocation& allocation)
+{
+	vkDestroyBuffer(_device, buffer, nullptr);
+	free(allocation);
+}
+
+void MemoryAllocator::createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation,
+	VkMemoryPropertyFlags preferredProperties)
+{
+	if (vkCreateImage(_device, &createInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(_device, image, &memoryRequirements);
+
+	if (preferredProperties != 0 && hasMemoryType(memoryRequirements.memoryTypeBits, properties | preferredProperties)) {
+		properties |= preferredProperties;
+	}
+
+	ResourceKind kind = createInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::OptimalImage : ResourceKind::Linear;
+	allocation = allocate(memoryRequirements, properties, kind);
+
+	if (vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to bind image memory!");
+	}
+}
+
+void MemoryAllocator::destroyImage(VkImage image, Allocation& allocation)
+{
+	vkDestroyImage(_device, image, nullptr);
+	free(allocation);
+}
+
+void MemoryAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (_memoryProperties.memoryTypes[allocation.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+		return;
+	}
+
+	// Non-coherent allocations are aligned to the atom size, so the rounded range stays inside them
+	VkDeviceSize begin = (allocation.offset + offset) & ~(_nonCoherentAtomSize - 1);
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : alignUp(allocation.offset + offset + size, _nonCoherentAtomSize);
+
+	VkMappedMemoryRange range = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+	range.memory = allocation.memory;
+	range.offset = begin;
+	range.size = std::min(end, allocation.offset + allocation.size) - begin;
+
+	vkFlushMappedMemoryRanges(_device, 1, &range);
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1u << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+bool MemoryAllocator::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1u << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+MemoryStats MemoryAllocator::getStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	MemoryStats stats;
+	stats.memoryTypes.resize(_memoryProperties.memoryTypeCount);
+	stats.dedicatedAllocationCount = _dedicatedAllocationCount;
+	stats.dedicatedBytes = _dedicatedBytes;
+	stats.deviceMemoryCount = _deviceMemoryCount;
+	stats.maxDeviceMemoryCount = _maxDeviceMemoryCount;
+
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+	{
+		MemoryTypeStats& typeStats = stats.memoryTypes[i];
+		VkDeviceSize freeBytes = 0;
+		VkDeviceSize largestFreeBytes = 0;
+
+		for (auto& blocks : _blocks[i])
+		{
+			for (auto& block : blocks)
+			{
+				++typeStats.blockCount;
+				typeStats.allocationCount += block->allocationCount;
+				typeStats.blockBytes += block->size;
+				typeStats.usedBytes += block->usedBytes;
+
+				VkDeviceSize blockLargestFree = 0;
+				for (auto& range : block->freeRanges)
+				{
+					freeBytes += range.second;
+					blockLargestFree = std::max(blockLargestFree, range.second);
+				}
+
+				largestFreeBytes += blockLargestFree;
+				typeStats.largestFreeRange = std::max(typeStats.largestFreeRange, blockLargestFree);
+			}
+		}
+
+		if (freeBytes > 0) {
+			// Measured per block, a type with several empty blocks is not fragmented
+			typeStats.fragmentation = 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes);
+		}
+	}
+
+	return stats;
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData)
+{
+	if (_deviceMemoryCount >= _maxDeviceMemoryCount) {
+		throw std::runtime_error("Exceeded maxMemoryAllocationCount!");
+	}
+
+	VkMemoryAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(_device, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate device memory!");
+	}
+
+	*mappedData = nullptr;
+	if (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS)
+		{
+			vkFreeMemory(_device, memory, nullptr);
+			throw std::runtime_error("Failed to map device memory!");
+		}
+	}
+
+	++_deviceMemoryCount;
+
+	return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory)
+{
+	// Freeing implicitly unmaps
+	vkFreeMemory(_device, memory, nullptr);
+	--_deviceMemoryCount;
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+{
+	// Small heaps, such as the 256 MB host-visible device-local heap on many GPUs, get smaller blocks
+	VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+	return std::min(_blockSize, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+}
+
+VkDeviceSize MemoryAllocator::getRequiredAlignment(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex) const
+{
+	VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+	// Flushes of non-coherent memory work on whole atoms, so allocations must not share one
+	VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+	if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		alignment = std::max(alignment, _nonCoherentAtomSize);
+	}
+
+	return alignment;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct MemoryBlock;
+
+// Buffers and linear images may not share a bufferImageGranularity page with optimal images,
+// so the two kinds are sub-allocated from separate blocks
+enum class ResourceKind
+{
+	Linear,
+	OptimalImage
+};
+
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// Host-visible memory stays mapped for its whole lifetime, null otherwise
+	void* mappedData = nullptr;
+	uint32_t memoryTypeIndex = 0;
+
+	// Owning block, null for dedicated allocations
+	MemoryBlock* block = nullptr;
+	bool isDedicated = false;
+};
+
+struct MemoryTypeStats
+{
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize blockBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	// 0 when all free space is one contiguous range, approaching 1 as it splits into small holes
+	float fragmentation = 0.0f;
+};
+
+struct MemoryStats
+{
+	std::vector<MemoryTypeStats> memoryTypes;
+	uint32_t dedicatedAllocationCount = 0;
+	VkDeviceSize dedicatedBytes = 0;
+	// Live vkAllocateMemory objects against VkPhysicalDeviceLimits::maxMemoryAllocationCount
+	uint32_t deviceMemoryCount = 0;
+	uint32_t maxDeviceMemoryCount = 0;
+};
+
+// Sub-allocates device memory out of large per-memory-type blocks to stay far below
+// maxMemoryAllocationCount and to avoid a driver round trip per resource
+class MemoryAllocator
+{
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+	void free(Allocation& allocation);
+
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation);
+	void destroyBuffer(VkBuffer buffer, Allocation& allocation);
+	// preferredProperties are added on top of properties when a memory type with both fits the image,
+	// e.g. LAZILY_ALLOCATED for transient attachments
+	void createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation,
+		VkMemoryPropertyFlags preferredProperties = 0);
+	void destroyImage(VkImage image, Allocation& allocation);
+
+	// Makes host writes to non-coherent memory visible to the device
+	void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return _memoryProperties; }
+
+	MemoryStats getStats();
+
+private:
+	VkDevice _device;
+	VkPhysicalDeviceMemoryProperties _memoryProperties;
+	VkDeviceSize _blockSize;
+	VkDeviceSize _nonCoherentAtomSize;
+	uint32_t _maxDeviceMemoryCount;
+
+	std::mutex _mutex;
+	// Indexed by memory type, then resource kind
+	std::vector<std::unique_ptr<MemoryBlock>> _blocks[VK_MAX_MEMORY_TYPES][2];
+	uint32_t _deviceMemoryCount = 0;
+	uint32_t _dedicatedAllocationCount = 0;
+	VkDeviceSize _dedicatedBytes = 0;
+
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+	void freeDeviceMemory(VkDeviceMemory memory);
+	VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+	VkDeviceSize getRequiredAlignment(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex) const;
+};
@@ -0,0 +1,171 @@
+#include "Model.h"
+
+#include "StartupTracer.h"
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+std::vector<VkVertexInputBindingDescription> Model::getBindingDescriptions(bool pullInstances)
+{
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(pullInstances ? 1 : 2);
+
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(Vertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	if (pullInstances) {
+		return bindingDescriptions;
+	}
+
+	bindingDescriptions[1].binding = 1;
+	bindingDescriptions[1].stride = sizeof(Instance);
+	bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> Model::getAttributeDescriptions(bool pullInstances)
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(pullInstances ? 2 : 5);
+
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[0].offset = offsetof(Vertex, position);
+
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+	if (pullInstances) {
+		return attributeDescriptions;
+	}
+
+	attributeDescriptions[2].location = 2;
+	attributeDescriptions[2].binding = 1;
+	attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributeDescriptions[2].offset = offsetof(Instance, transform);
+
+	attributeDescriptions[3].location = 3;
+	attributeDescriptions[3].binding = 1;
+	attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attributeDescriptions[3].offset = offsetof(Instance, color);
+
+	attributeDescriptions[4].location = 4;
+	attributeDescriptions[4].binding = 1;
+	attributeDescriptions[4].format = VK_FORMAT_R32_SFLOAT;
+	attributeDescriptions[4].offset = offsetof(Instance, depth);
+
+	return attributeDescriptions;
+}
+
+Model::Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<Instance>& instances)
+	: _device{ device }, _vertexCount{ static_cast<uint32_t>(vertices.size()) }, _instanceCount{ static_cast<uint32_t>(instances.size()) }
+{
+	StartupTracer::Scope scope("Model::Model");
+
+	if (vertices.empty() || instances.empty()) {
+		throw std::runtime_error("Model needs at least one vertex and one instance!");
+	}
+
+	// Both are uploaded once, the CPU never touches them again. Instances are read as vertex attributes or pulled from a storage buffer
+	_device.createDeviceLocalBuffer(vertices.data(), sizeof(Vertex) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _vertexBuffer, _vertexAllocation);
+	_device.createDeviceLocalBuffer(instances.data(), sizeof(Instance) * instances.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		_instanceBuffer, _instanceAllocation);
+}
+
+Model::~Model()
+{
+	if (_bindless)
+	{
+		_bindless->release(BindlessDescriptors::ResourceType::Buffer, _instanceHandle);
+		for (uint32_t handle : _streamHandles) {
+			_bindless->release(BindlessDescriptors::ResourceType::Buffer, handle);
+		}
+	}
+	for (size_t i = 0; i < _streamBuffers.size(); ++i) {
+		_device.getAllocator().destroyBuffer(_streamBuffers[i], _streamAllocations[i]);
+	}
+	_device.getAllocator().destroyBuffer(_instanceBuffer, _instanceAllocation);
+	_device.getAllocator().destroyBuffer(_vertexBuffer, _vertexAllocation);
+}
+
+void Model::enableInstanceStreaming(uint32_t framesInFlight)
+{
+	_streamingDirect = _device.hasUnifiedMemory();
+
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (_streamingDirect) {
+		properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+	else {
+		usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+
+	_streamBuffers.resize(framesInFlight);
+	_streamAllocations.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; ++i) {
+		_device.getAllocator().createBuffer(sizeof(Instance) * _instanceCount, usage, properties, _streamBuffers[i], _streamAllocations[i]);
+	}
+}
+
+void Model::streamInstances(uint32_t frameIndex, const std::vector<Instance>& instances, StagingRing* stagingRing)
+{
+	if (instances.size() != _instanceCount) {
+		throw std::runtime_error("Streamed instance count does not match the model!");
+	}
+
+	VkDeviceSize size = sizeof(Instance) * instances.size();
+	if (_streamingDirect)
+	{
+		std::memcpy(_streamAllocations[frameIndex].mappedData, instances.data(), static_cast<size_t>(size));
+		_device.getAllocator().flush(_streamAllocations[frameIndex]);
+	}
+	else
+	{
+		stagingRing->uploadBuffer(_streamBuffers[frameIndex], 0, instances.data(), size);
+	}
+
+	_streamFrame = frameIndex;
+}
+
+void Model::enableBindless(BindlessDescriptors& bindless)
+{
+	if (_bindless) {
+		throw std::runtime_error("Bindless is already enabled for the model!");
+	}
+
+	_bindless = &bindless;
+	_instanceHandle = bindless.addBuffer(_instanceBuffer);
+	for (VkBuffer streamBuffer : _streamBuffers) {
+		_streamHandles.push_back(bindless.addBuffer(streamBuffer));
+	}
+}
+
+void Model::bind(VkCommandBuffer commandBuffer)
+{
+	if (_bindless)
+	{
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &_vertexBuffer, &offset);
+		return;
+	}
+
+	VkBuffer instanceBuffer = _streamBuffers.empty() ? _instanceBuffer : _streamBuffers[_streamFrame];
+	VkBuffer buffers[] = { _vertexBuffer, instanceBuffer };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+}
+
+void Model::draw(VkCommandBuffer commandBuffer)
+{
+	vkCmdDraw(commandBuffer, _vertexCount, _instanceCount, 0, 0);
+}
+
+void Model::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t instanceCount)
+{
+	vkCmdDraw(commandBuffer, _vertexCount, instanceCount, 0, firstInstance);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "BindlessDescriptors.h"
+#include "Device.h"
+#include "StagingRing.h"
+
+#include <vector>
+
+// Vertex buffer of one shape plus a per-instance buffer, drawn with a single instanced draw
+class Model
+{
+public:
+	struct Vertex
+	{
+		float position[2];
+		float color[3];
+	};
+
+	// 24 bytes, so a million instances take about 24 MB
+	struct Instance
+	{
+		// Offset x, offset y, scale, rotation in radians
+		float transform[4];
+		// RGBA8, multiplied with the vertex color
+		uint32_t color;
+		// Clip space depth from 0 (near) to 1 (far)
+		float depth;
+	};
+
+	// Binding 0 advances per vertex, binding 1 per instance. When the vertex shader pulls the instances
+	// from a bindless buffer only the vertex binding is left
+	static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(bool pullInstances = false);
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(bool pullInstances = false);
+
+	Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<Instance>& instances);
+	~Model();
+
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	// Gives every frame in flight its own instance buffer for streamInstances. On unified memory the
+	// buffers are mapped and written directly, otherwise the data goes through a staging ring
+	void enableInstanceStreaming(uint32_t framesInFlight);
+	// Replaces all instances for the frame slot, bind uses that slot's buffer from then on.
+	// stagingRing may be null when isStreamingDirect
+	void streamInstances(uint32_t frameIndex, const std::vector<Instance>& instances, StagingRing* stagingRing);
+	bool isStreamingDirect() const { return _streamingDirect; }
+
+	// Registers every instance buffer, streamed ones included, so enable streaming first. From then on
+	// bind leaves the instance binding alone and the shader reads getInstanceBufferHandle instead
+	void enableBindless(BindlessDescriptors& bindless);
+	uint32_t getInstanceBufferHandle() const { return _streamBuffers.empty() ? _instanceHandle : _streamHandles[_streamFrame]; }
+
+	void bind(VkCommandBuffer commandBuffer);
+	void draw(VkCommandBuffer commandBuffer);
+	void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t instanceCount);
+
+	uint32_t getVertexCount() const { return _vertexCount; }
+	uint32_t getInstanceCount() const { return _instanceCount; }
+
+private:
+	Device& _device;
+
+	VkBuffer _vertexBuffer;
+	Allocation _vertexAllocation;
+	uint32_t _vertexCount;
+
+	VkBuffer _instanceBuffer;
+	Allocation _instanceAllocation;
+	uint32_t _instanceCount;
+
+	// Empty unless streaming is enabled
+	std::vector<VkBuffer> _streamBuffers;
+	std::vector<Allocation> _streamAllocations;
+	bool _streamingDirect = false;
+	uint32_t _streamFrame = 0;
+
+	// Null unless bindless is enabled
+	BindlessDescriptors* _bindless = nullptr;
+	uint32_t _instanceHandle = 0;
+	std::vector<uint32_t> _streamHandles;
+};
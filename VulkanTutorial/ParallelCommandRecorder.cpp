@@ -0,0 +1,102 @@
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ParallelCommandRecorder::ParallelCommandRecorder(Device& device, JobSystem& jobSystem, uint32_t framesInFlight, uint32_t slotCount)
+	: _device{ device }, _jobSystem{ jobSystem }, _slotCount{ slotCount > 0 ? slotCount : jobSystem.getThreadCount() },
+	_commandPools(framesInFlight), _commandBuffers(framesInFlight)
+{
+
+	VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.queueFamilyIndex = _device.getQueueFamilies().graphicFamily;
+	// No RESET_COMMAND_BUFFER_BIT, buffers are only ever recycled together with their pool
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (uint32_t frame = 0; frame < framesInFlight; ++frame)
+	{
+		_commandPools[frame].resize(_slotCount, VK_NULL_HANDLE);
+		_commandBuffers[frame].resize(_slotCount);
+
+		for (uint32_t slot = 0; slot < _slotCount; ++slot)
+		{
+			if (vkCreateCommandPool(_device.getDevice(), &poolInfo, nullptr, &_commandPools[frame][slot]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create worker command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+			allocateInfo.commandPool = _commandPools[frame][slot];
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocateInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(_device.getDevice(), &allocateInfo, &_commandBuffers[frame][slot]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate secondary command buffer!");
+			}
+		}
+	}
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+	// Destroying a pool frees its buffers
+	for (auto& framePools : _commandPools)
+	{
+		for (VkCommandPool commandPool : framePools) {
+			vkDestroyCommandPool(_device.getDevice(), commandPool, nullptr);
+		}
+	}
+}
+
+void ParallelCommandRecorder::beginFrame(uint32_t frameIndex)
+{
+	_frameIndex = frameIndex;
+
+	for (VkCommandPool commandPool : _commandPools[frameIndex]) {
+		vkResetCommandPool(_device.getDevice(), commandPool, 0);
+	}
+}
+
+const std::vector<VkCommandBuffer>& ParallelCommandRecorder::record(const VkCommandBufferInheritanceInfo& inheritanceInfo,
+	uint32_t itemCount, const RecordFunction& recordFunction)
+{
+	std::vector<VkCommandBuffer>& commandBuffers = _commandBuffers[_frameIndex];
+	uint32_t slotCount = static_cast<uint32_t>(commandBuffers.size());
+	uint32_t itemsPerSlot = (itemCount + slotCount - 1) / slotCount;
+
+	_recorded.clear();
+	JobCounter counter;
+
+	for (uint32_t slot = 0; slot < slotCount; ++slot)
+	{
+		uint32_t first = slot * itemsPerSlot;
+		if (first >= itemCount) {
+			break;
+		}
+		uint32_t count = std::min(itemsPerSlot, itemCount - first);
+
+		VkCommandBuffer commandBuffer = commandBuffers[slot];
+		_recorded.push_back(commandBuffer);
+
+		_jobSystem.run(counter, [=, &inheritanceInfo, &recordFunction]()
+		{
+			VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to begin recording secondary command buffer!");
+			}
+
+			recordFunction(commandBuffer, first, count);
+
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to record secondary command buffer!");
+			}
+		});
+	}
+
+	// Every job finishes before the first exception is rethrown, the arguments are referenced until then
+	_jobSystem.wait(counter);
+
+	return _recorded;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Device.h"
+#include "JobSystem.h"
+
+#include <functional>
+#include <vector>
+
+// Records the contents of a render pass into secondary command buffers as jobs.
+// Every slot has its own command pool per frame in flight and is recorded by a single job, so no pool is
+// ever used by two threads at once and a whole frame is recycled with one vkResetCommandPool per slot
+class ParallelCommandRecorder
+{
+public:
+	// Records items [first, first + count) into a secondary buffer that already has the render pass inherited
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count)>;
+
+	// Zero slots picks one per job system thread
+	ParallelCommandRecorder(Device& device, JobSystem& jobSystem, uint32_t framesInFlight, uint32_t slotCount = 0);
+	~ParallelCommandRecorder();
+
+	ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+	ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+	// Resets all pools of the frame, the frame's previous submission must have completed
+	void beginFrame(uint32_t frameIndex);
+
+	// Splits itemCount items evenly across the slots and runs jobs until all are recorded. inheritanceInfo names
+	// the render pass or, through its pNext chain, the dynamic rendering formats the buffers execute in.
+	// The returned buffers are meant for vkCmdExecuteCommands and stay valid until the frame's next beginFrame. Empty when itemCount is 0
+	const std::vector<VkCommandBuffer>& record(const VkCommandBufferInheritanceInfo& inheritanceInfo,
+		uint32_t itemCount, const RecordFunction& recordFunction);
+
+	uint32_t getSlotCount() const { return _slotCount; }
+
+private:
+	Device& _device;
+	JobSystem& _jobSystem;
+	uint32_t _slotCount;
+	uint32_t _frameIndex = 0;
+
+	// Indexed by frame, then slot
+	std::vector<std::vector<VkCommandPool>> _commandPools;
+	std::vector<std::vector<VkCommandBuffer>> _commandBuffers;
+
+	// Buffers handed out by the last record call
+	std::vector<VkCommandBuffer> _recorded;
+};
@@ -1,28 +1,254 @@
 #include "Pipeline.h"
 
-#include <fstream>
+#include "ShaderCode.h"
+#include "StartupTracer.h"
+
 #include <stdexcept>
 
-std::vector<char> Pipeline::readShaderFile(const std::string& filename)
+Pipeline::Pipeline(Device& device, VkPipelineCache pipelineCache, uint32_t threadCount)
+	: _device{ device }, _pipelineCache{ pipelineCache }, _threadPool{ threadCount }
+{
+}
+
+Pipeline::~Pipeline()
 {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	// Pipelines still compiling would otherwise leak
+	for (std::shared_future<VkPipeline>& future : _pending) {
+		future.wait();
+	}
 
-	if (!file.is_open())
-		throw std::runtime_error("Failed to open shader file!");
+	for (VkPipeline pipeline : _pipelines) {
+		vkDestroyPipeline(_device.getDevice(), pipeline, nullptr);
+	}
+}
+
+std::shared_future<VkPipeline> Pipeline::createGraphicPipeline(const PipelineConfigInfo& config)
+{
+	std::shared_future<VkPipeline> future = _threadPool.submit([this, config]() { return compileGraphicPipeline(config); }).share();
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	_pending.push_back(future);
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+	return future;
+}
+
+std::vector<std::shared_future<VkPipeline>> Pipeline::createGraphicPipelines(const std::vector<PipelineConfigInfo>& configs)
+{
+	std::vector<std::shared_future<VkPipeline>> futures;
+	futures.reserve(configs.size());
+
+	for (const PipelineConfigInfo& config : configs) {
+		futures.push_back(createGraphicPipeline(config));
+	}
+
+	return futures;
+}
+
+std::shared_future<VkPipeline> Pipeline::createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+{
+	std::shared_future<VkPipeline> future = _threadPool.submit([this, compFilePath, pipelineLayout]() { return compileComputePipeline(compFilePath, pipelineLayout); }).share();
 
-	file.close();
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	_pending.push_back(future);
 
-	return buffer;
+	return future;
 }
 
-void Pipeline::createGraphicPipeline(const std::string& vertFilePath, const std::string& fragFilePath)
+void Pipeline::destroyPipeline(VkPipeline pipeline)
 {
-	auto vertCode = readShaderFile("shaders/vert.spv");
-	auto fragCode = readShaderFile("shaders/frag.spv");
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+
+	for (size_t i = 0; i < _pipelines.size(); ++i)
+	{
+		if (_pipelines[i] == pipeline)
+		{
+			vkDestroyPipeline(_device.getDevice(), pipeline, nullptr);
+			_pipelines[i] = _pipelines.back();
+			_pipelines.pop_back();
+			return;
+		}
+	}
+}
+
+VkShaderModule Pipeline::createShaderModule(const std::string& filePath)
+{
+	ShaderCode code = ShaderCode::load(filePath);
+
+	VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+	createInfo.codeSize = code.size();
+	createInfo.pCode = code.data();
+
+	VkShaderModule shaderModule;
+	VkResult result;
+	{
+		StartupTracer::Scope callScope("vkCreateShaderModule", StartupTracer::Kind::DriverCall);
+		result = vkCreateShaderModule(_device.getDevice(), &createInfo, nullptr, &shaderModule);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shader module!");
+	}
+
+	return shaderModule;
+}
+
+VkPipeline Pipeline::compileGraphicPipeline(const PipelineConfigInfo& config)
+{
+	StartupTracer::Scope scope("Pipeline::compileGraphicPipeline");
+
+	bool depthOnly = config.fragFilePath.empty();
+
+	VkShaderModule vertShaderModule = createShaderModule(config.vertFilePath);
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	try {
+		if (!depthOnly) {
+			fragShaderModule = createShaderModule(config.fragFilePath);
+		}
+	}
+	catch (...) {
+		vkDestroyShaderModule(_device.getDevice(), vertShaderModule, nullptr);
+		throw;
+	}
+
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = vertShaderModule;
+	vertShaderStageInfo.pName = "main";
+
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = fragShaderModule;
+	fragShaderStageInfo.pName = "main";
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(config.bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = config.bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(config.attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = config.attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+	inputAssemblyInfo.topology = config.topology;
+	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	// Viewport and scissor are set while recording, so a resize never touches the pipelines
+	VkPipelineViewportStateCreateInfo viewportStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+	viewportStageInfo.viewportCount = 1;
+	viewportStageInfo.scissorCount = 1;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+	rasterizationStateInfo.depthClampEnable = VK_FALSE;
+	rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationStateInfo.cullMode = config.cullMode;
+	rasterizationStateInfo.frontFace = config.frontFace;
+	rasterizationStateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationStateInfo.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+	multisampling.rasterizationSamples = config.sampleCount;
+	multisampling.sampleShadingEnable = VK_FALSE;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+	depthStencil.depthTestEnable = config.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = config.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = config.depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	// Without a fragment shader the color outputs are undefined
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+#ifdef VK_KHR_dynamic_rendering
+	VkPipelineRenderingCreateInfoKHR renderingInfo = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR };
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &config.colorFormat;
+	renderingInfo.depthAttachmentFormat = config.depthFormat;
+	if (config.renderPass == VK_NULL_HANDLE) {
+		createInfo.pNext = &renderingInfo;
+	}
+#endif
+	createInfo.stageCount = depthOnly ? 1 : 2;
+	createInfo.pStages = shaderStages;
+	createInfo.pVertexInputState = &vertexInputInfo;
+	createInfo.pInputAssemblyState = &inputAssemblyInfo;
+	createInfo.pViewportState = &viewportStageInfo;
+	createInfo.pRasterizationState = &rasterizationStateInfo;
+	createInfo.pMultisampleState = &multisampling;
+	createInfo.pDepthStencilState = &depthStencil;
+	createInfo.pColorBlendState = &colorBlending;
+	createInfo.pDynamicState = &dynamicState;
+	createInfo.layout = config.pipelineLayout;
+	createInfo.renderPass = config.renderPass;
+	createInfo.subpass = config.subpass;
+	createInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkPipeline pipeline;
+	VkResult result;
+	{
+		StartupTracer::Scope callScope("vkCreateGraphicsPipelines", StartupTracer::Kind::DriverCall);
+		result = vkCreateGraphicsPipelines(_device.getDevice(), _pipelineCache, 1, &createInfo, nullptr, &pipeline);
+	}
+
+	if (fragShaderModule != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(_device.getDevice(), fragShaderModule, nullptr);
+	}
+	vkDestroyShaderModule(_device.getDevice(), vertShaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create graphic pipeline!");
+	}
+
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	_pipelines.push_back(pipeline);
+
+	return pipeline;
+}
+
+VkPipeline Pipeline::compileComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+{
+	StartupTracer::Scope scope("Pipeline::compileComputePipeline");
+
+	VkShaderModule compShaderModule = createShaderModule(compFilePath);
+
+	VkComputePipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createInfo.stage.module = compShaderModule;
+	createInfo.stage.pName = "main";
+	createInfo.layout = pipelineLayout;
+	createInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkPipeline pipeline;
+	VkResult result;
+	{
+		StartupTracer::Scope callScope("vkCreateComputePipelines", StartupTracer::Kind::DriverCall);
+		result = vkCreateComputePipelines(_device.getDevice(), _pipelineCache, 1, &createInfo, nullptr, &pipeline);
+	}
+
+	vkDestroyShaderModule(_device.getDevice(), compShaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create compute pipeline!");
+	}
+
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	_pipelines.push_back(pipeline);
+
+	return pipeline;
 }
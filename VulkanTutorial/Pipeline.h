@@ -1,16 +1,76 @@
 #pragma once
 
+#include "Device.h"
+#include "ThreadPool.h"
+
+#include <future>
+#include <mutex>
 #include <string>
 #include <vector>
 
+// Everything that distinguishes one graphics pipeline variant from another
+struct PipelineConfigInfo
+{
+	std::string vertFilePath;
+	// Empty builds a depth-only pipeline without a fragment stage and with color writes masked off
+	std::string fragFilePath;
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	// VK_NULL_HANDLE builds the pipeline for dynamic rendering into colorFormat and depthFormat instead
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	// Must match the attachments of the render pass or dynamic rendering
+	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+	// Left empty when the vertex shader generates its own vertices
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	bool depthTest = true;
+	bool depthWrite = true;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+};
+
+// Pipeline factory. Pipelines are compiled on a worker pool and handed back as futures,
+// so callers can start using the first ones while the rest are still being built
 class Pipeline
 {
 public:
-	Pipeline(const std::string& vertFilePath, const std::string& fragFilePath);
+	// The cache may be VK_NULL_HANDLE. Pipeline caches are internally synchronized,
+	// so all workers share it without extra locking
+	Pipeline(Device& device, VkPipelineCache pipelineCache, uint32_t threadCount = 0);
 	~Pipeline();
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	std::shared_future<VkPipeline> createGraphicPipeline(const PipelineConfigInfo& config);
+	std::vector<std::shared_future<VkPipeline>> createGraphicPipelines(const std::vector<PipelineConfigInfo>& configs);
+	std::shared_future<VkPipeline> createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout);
+
+	// Pipelines are owned by the factory and destroyed with it
+	void destroyPipeline(VkPipeline pipeline);
+
+	uint32_t getThreadCount() const { return _threadPool.getThreadCount(); }
+
 private:
-	static std::vector<char> readShaderFile(const std::string& filename);
+	Device& _device;
+	VkPipelineCache _pipelineCache;
 
-	void createGraphicPipeline(const std::string& vertFilePath, const std::string& fragFilePath);
-};
+	std::mutex _pipelinesMutex;
+	std::vector<VkPipeline> _pipelines;
+	std::vector<std::shared_future<VkPipeline>> _pending;
 
+	// Declared last so workers are joined before the members they use are destroyed
+	ThreadPool _threadPool;
+
+	VkPipeline compileGraphicPipeline(const PipelineConfigInfo& config);
+	VkPipeline compileComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout);
+	VkShaderModule createShaderModule(const std::string& filePath);
+};
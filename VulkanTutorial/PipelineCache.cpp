@@ -0,0 +1,133 @@
+#include "PipelineCache.h"
+
+#include "StartupTracer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, all fields are little-endian 32-bit words
+// followed by the pipeline cache UUID
+static const size_t CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+PipelineCache::PipelineCache(Device& device, const std::string& filePath) : _device{ device }, _filePath{ filePath }
+{
+	StartupTracer::Scope scope("PipelineCache::PipelineCache");
+
+	std::vector<char> data = loadCacheFile();
+
+	_isWarm = !data.empty() && isHeaderValid(data);
+	if (!data.empty() && !_isWarm) {
+		std::cerr << "Ignoring stale pipeline cache " << _filePath << std::endl;
+	}
+
+	VkPipelineCacheCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	if (_isWarm)
+	{
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.data();
+	}
+
+	if (vkCreatePipelineCache(_device.getDevice(), &createInfo, nullptr, &_cache) == VK_SUCCESS) {
+		return;
+	}
+
+	// The driver rejected the data even though the header matched, start from an empty cache
+	_isWarm = false;
+	createInfo.initialDataSize = 0;
+	createInfo.pInitialData = nullptr;
+
+	if (vkCreatePipelineCache(_device.getDevice(), &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+}
+
+PipelineCache::~PipelineCache()
+{
+	try {
+		save();
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+	}
+
+	vkDestroyPipelineCache(_device.getDevice(), _cache, nullptr);
+}
+
+void PipelineCache::save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(_device.getDevice(), _cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(_device.getDevice(), _cache, &dataSize, data.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to get pipeline cache data!");
+	}
+
+	// Write next to the target first so an interrupted save never leaves a truncated cache behind
+	std::string tempPath = _filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open pipeline cache file for writing!");
+		}
+
+		file.write(data.data(), dataSize);
+		if (!file) {
+			throw std::runtime_error("Failed to write pipeline cache file!");
+		}
+	}
+
+	std::remove(_filePath.c_str());
+	if (std::rename(tempPath.c_str(), _filePath.c_str()) != 0) {
+		throw std::runtime_error("Failed to replace pipeline cache file!");
+	}
+}
+
+std::vector<char> PipelineCache::loadCacheFile()
+{
+	std::ifstream file(_filePath, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		return {};
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	if (!file) {
+		return {};
+	}
+
+	return buffer;
+}
+
+bool PipelineCache::isHeaderValid(const std::vector<char>& data)
+{
+	if (data.size() < CACHE_HEADER_SIZE) {
+		return false;
+	}
+
+	uint32_t headerSize;
+	uint32_t headerVersion;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	std::memcpy(&headerSize, data.data(), 4);
+	std::memcpy(&headerVersion, data.data() + 4, 4);
+	std::memcpy(&vendorID, data.data() + 8, 4);
+	std::memcpy(&deviceID, data.data() + 12, 4);
+
+	VkPhysicalDeviceProperties properties = _device.getProperties();
+
+	return headerSize >= CACHE_HEADER_SIZE && headerSize <= data.size() &&
+		headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		vendorID == properties.vendorID &&
+		deviceID == properties.deviceID &&
+		std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Device.h"
+
+#include <string>
+
+// VkPipelineCache that is loaded from disk on creation and written back on destruction
+class PipelineCache
+{
+public:
+	PipelineCache(Device& device, const std::string& filePath);
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	VkPipelineCache getCache() { return _cache; }
+
+	// True if the cache was seeded from a valid file of the current device
+	bool isWarm() const { return _isWarm; }
+
+	void save();
+
+private:
+	Device& _device;
+	std::string _filePath;
+
+	VkPipelineCache _cache;
+	bool _isWarm = false;
+
+	std::vector<char> loadCacheFile();
+	bool isHeaderValid(const std::vector<char>& data);
+};
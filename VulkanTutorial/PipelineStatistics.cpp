@@ -0,0 +1,68 @@
+#include "PipelineStatistics.h"
+
+PipelineStatistics::PipelineStatistics(Device& device, uint32_t framesInFlight) : _device{ device }, _pending(framesInFlight, false)
+{
+	if (!_device.getEnabledFeatures().pipelineStatisticsQuery) {
+		throw std::runtime_error("Pipeline statistics queries are not supported!");
+	}
+
+	// Results come back in bit order: vertex shader, then fragment shader invocations
+	VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	createInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	createInfo.queryCount = framesInFlight;
+	createInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	if (vkCreateQueryPool(_device.getDevice(), &createInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline statistics query pool!");
+	}
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+	vkDestroyQueryPool(_device.getDevice(), _queryPool, nullptr);
+}
+
+void PipelineStatistics::begin(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	_currentFrame = frameIndex;
+
+	if (_pending[frameIndex]) {
+		collectResults(frameIndex);
+	}
+	_pending[frameIndex] = true;
+
+	vkCmdResetQueryPool(commandBuffer, _queryPool, frameIndex, 1);
+	vkCmdBeginQuery(commandBuffer, _queryPool, frameIndex, 0);
+}
+
+void PipelineStatistics::end(VkCommandBuffer commandBuffer)
+{
+	vkCmdEndQuery(commandBuffer, _queryPool, _currentFrame);
+}
+
+void PipelineStatistics::collectPendingResults()
+{
+	for (uint32_t i = 0; i < _pending.size(); ++i)
+	{
+		if (_pending[i]) {
+			collectResults(i);
+		}
+		_pending[i] = false;
+	}
+}
+
+void PipelineStatistics::collectResults(uint32_t frameIndex)
+{
+	uint64_t results[2];
+	VkResult result = vkGetQueryPoolResults(_device.getDevice(), _queryPool, frameIndex, 1,
+		sizeof(results), results, sizeof(results), VK_QUERY_RESULT_64_BIT);
+
+	// A frame whose query is not available yet is dropped instead of stalling on it
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	++_totals.frameCount;
+	_totals.vertexInvocations += results[0];
+	_totals.fragmentInvocations += results[1];
+}
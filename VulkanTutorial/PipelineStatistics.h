@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Device.h"
+
+#include <vector>
+
+// Counts the shader invocations of every frame with a pipeline statistics query around its draws.
+// Results are read back when the same frame slot comes around again, like the profiler's timestamps
+class PipelineStatistics
+{
+public:
+	struct Totals
+	{
+		uint64_t frameCount = 0;
+		uint64_t vertexInvocations = 0;
+		uint64_t fragmentInvocations = 0;
+	};
+
+	// Throws when the device lacks the pipelineStatisticsQuery feature
+	PipelineStatistics(Device& device, uint32_t framesInFlight);
+	~PipelineStatistics();
+
+	PipelineStatistics(const PipelineStatistics&) = delete;
+	PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+
+	// Both outside of a render pass. Must be called after the frame slot's previous submission has finished
+	void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void end(VkCommandBuffer commandBuffer);
+
+	// Reads back every frame still holding a query, the device must be idle
+	void collectPendingResults();
+
+	const Totals& getTotals() const { return _totals; }
+
+private:
+	Device& _device;
+	VkQueryPool _queryPool = VK_NULL_HANDLE;
+
+	std::vector<bool> _pending;
+	uint32_t _currentFrame = 0;
+
+	Totals _totals;
+
+	void collectResults(uint32_t frameIndex);
+};
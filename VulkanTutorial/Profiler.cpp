@@ -0,0 +1,279 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+void RollingStats::add(double value)
+{
+	_samples[_next] = value;
+	_next = (_next + 1) % _samples.size();
+	if (_next == 0) {
+		_full = true;
+	}
+}
+
+double RollingStats::average() const
+{
+	size_t n = count();
+	if (n == 0) {
+		return 0.0;
+	}
+
+	double sum = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		sum += _samples[i];
+	}
+	return sum / n;
+}
+
+double RollingStats::percentile(double fraction) const
+{
+	size_t n = count();
+	if (n == 0) {
+		return 0.0;
+	}
+
+	std::vector<double> sorted(_samples.begin(), _samples.begin() + n);
+	size_t index = static_cast<size_t>(fraction * (n - 1) + 0.5);
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+
+	return sorted[index];
+}
+
+double RollingStats::max() const
+{
+	size_t n = count();
+	if (n == 0) {
+		return 0.0;
+	}
+
+	return *std::max_element(_samples.begin(), _samples.begin() + n);
+}
+
+Profiler::Profiler(Device& device, uint32_t framesInFlight) : _device{ device }, _frames(framesInFlight), _startTime{ Clock::now() }
+{
+	_threads.push_back(std::this_thread::get_id());
+
+	VkPhysicalDeviceProperties properties = _device.getProperties();
+	_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_device.getPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_device.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[_device.getQueueFamilies().graphicFamily].timestampValidBits;
+	_timestampMask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+
+	// Queues without timestamp support only get CPU timings
+	if (validBits == 0) {
+		return;
+	}
+
+	VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = framesInFlight * MAX_GPU_SCOPES * 2;
+
+	if (vkCreateQueryPool(_device.getDevice(), &createInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timestamp query pool!");
+	}
+}
+
+Profiler::~Profiler()
+{
+	if (_queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(_device.getDevice(), _queryPool, nullptr);
+	}
+}
+
+void Profiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	_currentFrame = frameIndex;
+
+	FrameSlot& frame = _frames[frameIndex];
+	if (frame.queryCount > 0) {
+		collectGpuResults(frameIndex);
+	}
+
+	frame.scopes.clear();
+	frame.openScopes.clear();
+	frame.queryCount = 0;
+	frame.recordTimeUs = toMicroseconds(Clock::now());
+
+	if (_queryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, _queryPool, frameIndex * MAX_GPU_SCOPES * 2, MAX_GPU_SCOPES * 2);
+	}
+}
+
+void Profiler::beginGpuScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	FrameSlot& frame = _frames[_currentFrame];
+	if (_queryPool == VK_NULL_HANDLE || frame.scopes.size() == MAX_GPU_SCOPES) {
+		return;
+	}
+
+	GpuScope scope;
+	scope.name = name;
+	scope.beginQuery = _currentFrame * MAX_GPU_SCOPES * 2 + frame.queryCount++;
+	scope.endQuery = scope.beginQuery;
+
+	frame.openScopes.push_back(frame.scopes.size());
+	frame.scopes.push_back(scope);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, scope.beginQuery);
+}
+
+void Profiler::endGpuScope(VkCommandBuffer commandBuffer)
+{
+	FrameSlot& frame = _frames[_currentFrame];
+	if (_queryPool == VK_NULL_HANDLE || frame.openScopes.empty()) {
+		return;
+	}
+
+	GpuScope& scope = frame.scopes[frame.openScopes.back()];
+	frame.openScopes.pop_back();
+
+	scope.endQuery = _currentFrame * MAX_GPU_SCOPES * 2 + frame.queryCount++;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, scope.endQuery);
+}
+
+void Profiler::addCpuSample(const char* name, Clock::time_point start, Clock::time_point end)
+{
+	double durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+	std::lock_guard<std::mutex> lock(_samplesMutex);
+	_metrics[std::string("cpu ") + name].add(durationUs / 1000.0);
+
+	// Scopes of the job graph overlap on the worker threads, Chrome only nests events within one row
+	std::thread::id threadId = std::this_thread::get_id();
+	auto thread = std::find(_threads.begin(), _threads.end(), threadId);
+	if (thread == _threads.end()) {
+		thread = _threads.insert(_threads.end(), threadId);
+	}
+	addTraceEvent({ name, toMicroseconds(start), durationUs, false, static_cast<uint32_t>(thread - _threads.begin()) });
+}
+
+void Profiler::collectPendingResults()
+{
+	for (uint32_t i = 0; i < _frames.size(); ++i)
+	{
+		if (_frames[i].queryCount > 0) {
+			collectGpuResults(i);
+		}
+		_frames[i].queryCount = 0;
+	}
+}
+
+void Profiler::collectGpuResults(uint32_t frameIndex)
+{
+	FrameSlot& frame = _frames[frameIndex];
+	uint32_t firstQuery = frameIndex * MAX_GPU_SCOPES * 2;
+
+	uint64_t timestamps[MAX_GPU_SCOPES * 2];
+	VkResult result = vkGetQueryPoolResults(_device.getDevice(), _queryPool, firstQuery, frame.queryCount,
+		sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	// A frame whose queries are not available yet is dropped instead of stalling on it
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_samplesMutex);
+	uint64_t frameStart = timestamps[0] & _timestampMask;
+	for (const GpuScope& scope : frame.scopes)
+	{
+		if (scope.endQuery == scope.beginQuery) {
+			continue;
+		}
+
+		uint64_t begin = timestamps[scope.beginQuery - firstQuery] & _timestampMask;
+		uint64_t end = timestamps[scope.endQuery - firstQuery] & _timestampMask;
+		double durationUs = (end - begin) * _timestampPeriod / 1000.0;
+		double offsetUs = (begin - frameStart) * _timestampPeriod / 1000.0;
+
+		_metrics[std::string("gpu ") + scope.name].add(durationUs / 1000.0);
+		addTraceEvent({ scope.name, frame.recordTimeUs + offsetUs, durationUs, true, 0 });
+	}
+}
+
+void Profiler::addTraceEvent(const TraceEvent& event)
+{
+	if (_traceEvents.size() == MAX_TRACE_EVENTS) {
+		_traceEvents.pop_front();
+	}
+	_traceEvents.push_back(event);
+}
+
+double Profiler::toMicroseconds(Clock::time_point time) const
+{
+	return std::chrono::duration<double, std::micro>(time - _startTime).count();
+}
+
+static bool endsWith(const std::string& value, const std::string& suffix)
+{
+	return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void Profiler::writeReport(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open profiler report file!");
+	}
+
+	if (endsWith(filePath, ".json"))
+	{
+		file << "{\n  \"metrics\": [";
+		bool first = true;
+		for (const auto& metric : _metrics)
+		{
+			file << (first ? "\n" : ",\n");
+			file << "    { \"name\": \"" << metric.first << "\", \"count\": " << metric.second.count()
+				<< ", \"avg_ms\": " << metric.second.average()
+				<< ", \"p50_ms\": " << metric.second.percentile(0.5)
+				<< ", \"p99_ms\": " << metric.second.percentile(0.99)
+				<< ", \"max_ms\": " << metric.second.max() << " }";
+			first = false;
+		}
+		file << "\n  ]\n}\n";
+	}
+	else
+	{
+		file << "metric,count,avg_ms,p50_ms,p99_ms,max_ms\n";
+		for (const auto& metric : _metrics)
+		{
+			file << metric.first << "," << metric.second.count()
+				<< "," << metric.second.average()
+				<< "," << metric.second.percentile(0.5)
+				<< "," << metric.second.percentile(0.99)
+				<< "," << metric.second.max() << "\n";
+		}
+	}
+}
+
+void Profiler::writeChromeTrace(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open trace file!");
+	}
+
+	// The GPU track follows the rows of the CPU threads
+	size_t gpuTrack = _threads.size();
+
+	file << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < _threads.size(); ++i)
+	{
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << (i == 0 ? "CPU main" : "CPU worker") << "\"}},\n";
+	}
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << gpuTrack << ",\"args\":{\"name\":\"GPU\"}}";
+	for (const TraceEvent& event : _traceEvents)
+	{
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+			<< ",\"pid\":0,\"tid\":" << (event.gpu ? gpuTrack : event.thread) << "}";
+	}
+	file << "\n]}\n";
+}
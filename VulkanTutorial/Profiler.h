@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Device.h"
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Keeps the most recent samples of one metric and answers percentile queries over them
+class RollingStats
+{
+public:
+	explicit RollingStats(size_t capacity = 1024) : _samples(capacity) {}
+
+	void add(double value);
+
+	size_t count() const { return _full ? _samples.size() : _next; }
+	double average() const;
+	double percentile(double fraction) const;
+	double max() const;
+
+private:
+	std::vector<double> _samples;
+	size_t _next = 0;
+	bool _full = false;
+};
+
+// CPU and GPU frame timing. GPU scopes are timestamp queries written into the frame's
+// command buffer, they are read back when the same frame slot comes around again
+class Profiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static const uint32_t MAX_GPU_SCOPES = 32;
+
+	Profiler(Device& device, uint32_t framesInFlight);
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Must be called after the frame slot's previous submission has finished and outside of a render pass
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Names must outlive the profiler, string literals are expected
+	void beginGpuScope(VkCommandBuffer commandBuffer, const char* name);
+	void endGpuScope(VkCommandBuffer commandBuffer);
+
+	// Thread safe, CPU scopes may end on any thread
+	void addCpuSample(const char* name, Clock::time_point start, Clock::time_point end);
+
+	// Reads back every frame still holding queries, the device must be idle
+	void collectPendingResults();
+
+	// Summary of every metric, written as CSV or JSON depending on the file extension
+	void writeReport(const std::string& filePath) const;
+	// Timeline of the most recent scopes in the Chrome trace event format (chrome://tracing)
+	void writeChromeTrace(const std::string& filePath) const;
+
+	class CpuScope
+	{
+	public:
+		// A null profiler turns the scope into a no-op
+		CpuScope(Profiler* profiler, const char* name) : _profiler{ profiler }, _name{ name }
+		{
+			if (_profiler) _start = Clock::now();
+		}
+		~CpuScope()
+		{
+			if (_profiler) _profiler->addCpuSample(_name, _start, Clock::now());
+		}
+
+	private:
+		Profiler* _profiler;
+		const char* _name;
+		Clock::time_point _start;
+	};
+
+private:
+	static const size_t MAX_TRACE_EVENTS = 100000;
+
+	struct GpuScope
+	{
+		const char* name;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct FrameSlot
+	{
+		std::vector<GpuScope> scopes;
+		std::vector<size_t> openScopes;
+		uint32_t queryCount = 0;
+		// CPU time the frame was recorded at, used to place its GPU scopes on the trace timeline
+		double recordTimeUs = 0.0;
+	};
+
+	struct TraceEvent
+	{
+		const char* name;
+		double startUs;
+		double durationUs;
+		// GPU scopes share one track, CPU scopes go to the row of the thread that recorded them
+		bool gpu;
+		uint32_t thread;
+	};
+
+	Device& _device;
+	VkQueryPool _queryPool = VK_NULL_HANDLE;
+	double _timestampPeriod;
+	uint64_t _timestampMask;
+
+	std::vector<FrameSlot> _frames;
+	uint32_t _currentFrame = 0;
+
+	Clock::time_point _startTime;
+	// Guards the metrics and trace events
+	std::mutex _samplesMutex;
+	std::map<std::string, RollingStats> _metrics;
+	std::deque<TraceEvent> _traceEvents;
+	// Index in this list is the trace row of the thread, the one creating the profiler comes first
+	std::vector<std::thread::id> _threads;
+
+	void collectGpuResults(uint32_t frameIndex);
+	void addTraceEvent(const TraceEvent& event);
+	double toMicroseconds(Clock::time_point time) const;
+};
@@ -0,0 +1,31 @@
+#include "RingRegion.h"
+
+#include "Alignment.h"
+
+void RingRegion::reset(VkDeviceSize begin, VkDeviceSize size)
+{
+	_end = begin + size;
+	_offset = begin;
+	_flushedOffset = begin;
+}
+
+bool RingRegion::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	VkDeviceSize alignedOffset = alignUp(_offset, alignment);
+	if (alignedOffset + size > _end) {
+		return false;
+	}
+
+	offset = alignedOffset;
+	_offset = alignedOffset + size;
+	return true;
+}
+
+void RingRegion::flush(MemoryAllocator& allocator, const Allocation& allocation)
+{
+	if (_offset > _flushedOffset)
+	{
+		allocator.flush(allocation, _flushedOffset, _offset - _flushedOffset);
+		_flushedOffset = _offset;
+	}
+}
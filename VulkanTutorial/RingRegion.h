@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// Linear sub-allocation inside one range of a persistently mapped allocation, flushed incrementally.
+// A ring rewinds its frame region to the current slot's range every frame
+class RingRegion
+{
+public:
+	// Starts over at the beginning of [begin, begin + size)
+	void reset(VkDeviceSize begin, VkDeviceSize size);
+
+	// Offset of size bytes at the next multiple of alignment, false when they do not fit before the end
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+	// Makes the bytes allocated since the last flush visible to the device
+	void flush(MemoryAllocator& allocator, const Allocation& allocation);
+
+private:
+	VkDeviceSize _end = 0;
+	VkDeviceSize _offset = 0;
+	VkDeviceSize _flushedOffset = 0;
+};
@@ -0,0 +1,355 @@
+#include "Scene.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SCENE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// SSE2 is part of x86-64, 32-bit builds only have it when compiled for it
+#if defined(SCENE_X86) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SCENE_SSE
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere, GCC and Clang only in functions targeting it
+#if defined(SCENE_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SCENE_TARGET_AVX2
+#else
+#define SCENE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Floats per block and the offset of each field, matching Scene::Block
+static const uint32_t BLOCK_FLOATS = Scene::BLOCK_SIZE * 4;
+static const uint32_t CENTER_X = 0;
+static const uint32_t CENTER_Y = Scene::BLOCK_SIZE;
+static const uint32_t CENTER_Z = Scene::BLOCK_SIZE * 2;
+static const uint32_t RADIUS = Scene::BLOCK_SIZE * 3;
+
+// Blocks culled by one job
+static const uint32_t JOB_BLOCKS = 1024;
+
+Frustum Frustum::fromView(const float view[4])
+{
+	// clip = world * zoom + offset. Divided by the zoom, so the distances are in world units like the radii
+	float zoom = view[2];
+
+	Frustum frustum = {
+		{
+			{ 1.0f, 0.0f, 0.0f, (1.0f + view[0]) / zoom },
+			{ -1.0f, 0.0f, 0.0f, (1.0f - view[0]) / zoom },
+			{ 0.0f, 1.0f, 0.0f, (1.0f + view[1]) / zoom },
+			{ 0.0f, -1.0f, 0.0f, (1.0f - view[1]) / zoom },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, -1.0f, 1.0f }
+		}
+	};
+	return frustum;
+}
+
+// The sphere is visible when its center is no further than its radius behind any plane. All paths evaluate
+// x * nx + y * ny + z * nz + d + r in this order without fused multiply-adds, so their results are bit-identical
+static uint32_t cullScalar(const float planes[6][4], const float* blocks, uint32_t blockCount, uint32_t firstObject, uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+
+	for (uint32_t block = 0; block < blockCount; ++block)
+	{
+		const float* data = blocks + block * BLOCK_FLOATS;
+		for (uint32_t lane = 0; lane < Scene::BLOCK_SIZE; ++lane)
+		{
+			float x = data[CENTER_X + lane];
+			float y = data[CENTER_Y + lane];
+			float z = data[CENTER_Z + lane];
+			float radius = data[RADIUS + lane];
+
+			bool inside = true;
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				float distance = x * planes[plane][0] + y * planes[plane][1] + z * planes[plane][2] + planes[plane][3] + radius;
+				inside &= distance >= 0.0f;
+			}
+
+			// Written unconditionally and kept only when visible, so the loop has no branch to mispredict
+			visible[visibleCount] = firstObject + block * Scene::BLOCK_SIZE + lane;
+			visibleCount += inside ? 1 : 0;
+		}
+	}
+
+	return visibleCount;
+}
+
+#if defined(SCENE_SSE)
+static uint32_t cullSse(const float planes[6][4], const float* blocks, uint32_t blockCount, uint32_t firstObject, uint32_t* visible)
+{
+	__m128 planeVectors[6][4];
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		for (int i = 0; i < 4; ++i) {
+			planeVectors[plane][i] = _mm_set1_ps(planes[plane][i]);
+		}
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t visibleCount = 0;
+
+	for (uint32_t block = 0; block < blockCount; ++block)
+	{
+		const float* data = blocks + block * BLOCK_FLOATS;
+
+		// Each block is two halves of four lanes
+		for (uint32_t half = 0; half < Scene::BLOCK_SIZE; half += 4)
+		{
+			__m128 x = _mm_loadu_ps(data + CENTER_X + half);
+			__m128 y = _mm_loadu_ps(data + CENTER_Y + half);
+			__m128 z = _mm_loadu_ps(data + CENTER_Z + half);
+			__m128 radius = _mm_loadu_ps(data + RADIUS + half);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				__m128 distance = _mm_mul_ps(x, planeVectors[plane][0]);
+				distance = _mm_add_ps(distance, _mm_mul_ps(y, planeVectors[plane][1]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(z, planeVectors[plane][2]));
+				distance = _mm_add_ps(distance, planeVectors[plane][3]);
+				distance = _mm_add_ps(distance, radius);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			uint32_t object = firstObject + block * Scene::BLOCK_SIZE + half;
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				visible[visibleCount] = object + lane;
+				visibleCount += (mask >> lane) & 1;
+			}
+		}
+	}
+
+	return visibleCount;
+}
+#endif
+
+#if defined(SCENE_X86)
+// For every 8 bit visibility mask, the lanes of the set bits packed to the front
+struct CompactionTable
+{
+	uint32_t lanes[256][8];
+	uint32_t counts[256];
+
+	CompactionTable()
+	{
+		for (uint32_t mask = 0; mask < 256; ++mask)
+		{
+			uint32_t count = 0;
+			for (uint32_t lane = 0; lane < 8; ++lane)
+			{
+				lanes[mask][lane] = 0;
+				if (mask & (1u << lane)) {
+					lanes[mask][count++] = lane;
+				}
+			}
+			counts[mask] = count;
+		}
+	}
+};
+
+static const CompactionTable compactionTable;
+
+SCENE_TARGET_AVX2
+static uint32_t cullAvx2(const float planes[6][4], const float* blocks, uint32_t blockCount, uint32_t firstObject, uint32_t* visible)
+{
+	__m256 planeVectors[6][4];
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		for (int i = 0; i < 4; ++i) {
+			planeVectors[plane][i] = _mm256_set1_ps(planes[plane][i]);
+		}
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	uint32_t visibleCount = 0;
+
+	for (uint32_t block = 0; block < blockCount; ++block)
+	{
+		const float* data = blocks + block * BLOCK_FLOATS;
+
+		__m256 x = _mm256_loadu_ps(data + CENTER_X);
+		__m256 y = _mm256_loadu_ps(data + CENTER_Y);
+		__m256 z = _mm256_loadu_ps(data + CENTER_Z);
+		__m256 radius = _mm256_loadu_ps(data + RADIUS);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			__m256 distance = _mm256_mul_ps(x, planeVectors[plane][0]);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(y, planeVectors[plane][1]));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(z, planeVectors[plane][2]));
+			distance = _mm256_add_ps(distance, planeVectors[plane][3]);
+			distance = _mm256_add_ps(distance, radius);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+		}
+
+		// Packs the indices of the visible lanes with one permute and stores all eight, the rest is overwritten next
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+		__m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstObject + block * Scene::BLOCK_SIZE)), laneOffsets);
+		__m256i permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compactionTable.lanes[mask]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + visibleCount), _mm256_permutevar8x32_epi32(indices, permutation));
+		visibleCount += compactionTable.counts[mask];
+	}
+
+	return visibleCount;
+}
+
+static bool cpuSupportsAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// The OS has to save the YMM registers as well
+	__cpuid(info, 1);
+	bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	if (!osSavesAvx) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+uint32_t Scene::addObject(const float center[3], float radius, uint32_t firstInstance, uint32_t instanceCount)
+{
+	uint32_t object = _objectCount++;
+	uint32_t lane = object % BLOCK_SIZE;
+
+	if (lane == 0)
+	{
+		Block block;
+		for (uint32_t i = 0; i < BLOCK_SIZE; ++i)
+		{
+			block.centerX[i] = 0.0f;
+			block.centerY[i] = 0.0f;
+			block.centerZ[i] = 0.0f;
+			block.radius[i] = -FLT_MAX;
+		}
+		_blocks.push_back(block);
+	}
+
+	Block& block = _blocks.back();
+	block.centerX[lane] = center[0];
+	block.centerY[lane] = center[1];
+	block.centerZ[lane] = center[2];
+	block.radius[lane] = radius;
+
+	_firstInstances.push_back(firstInstance);
+	_instanceCounts.push_back(instanceCount);
+
+	return object;
+}
+
+void Scene::clear()
+{
+	_blocks.clear();
+	_firstInstances.clear();
+	_instanceCounts.clear();
+	_objectCount = 0;
+}
+
+uint32_t Scene::cull(const Frustum& frustum, std::vector<uint32_t>& visible, JobSystem* jobSystem) const
+{
+	uint32_t blockCount = getBlockCount();
+	visible.resize(static_cast<size_t>(blockCount) * BLOCK_SIZE);
+
+	if (!jobSystem || blockCount <= JOB_BLOCKS) {
+		return cullBlocks(frustum, 0, blockCount, visible.data());
+	}
+
+	// Every job compacts into the start of its own range, the ranges are joined afterwards
+	uint32_t jobCount = (blockCount + JOB_BLOCKS - 1) / JOB_BLOCKS;
+	std::vector<uint32_t> jobCounts(jobCount);
+
+	jobSystem->parallelFor(blockCount, JOB_BLOCKS, [&](uint32_t firstBlock, uint32_t count)
+	{
+		jobCounts[firstBlock / JOB_BLOCKS] = cullBlocks(frustum, firstBlock, count, visible.data() + firstBlock * BLOCK_SIZE);
+	});
+
+	uint32_t visibleCount = jobCounts[0];
+	for (uint32_t job = 1; job < jobCount; ++job)
+	{
+		const uint32_t* source = visible.data() + job * JOB_BLOCKS * BLOCK_SIZE;
+		std::memmove(visible.data() + visibleCount, source, jobCounts[job] * sizeof(uint32_t));
+		visibleCount += jobCounts[job];
+	}
+
+	return visibleCount;
+}
+
+uint32_t Scene::cullBlocks(const Frustum& frustum, uint32_t firstBlock, uint32_t blockCount, uint32_t* visible) const
+{
+	const float* blocks = reinterpret_cast<const float*>(_blocks.data() + firstBlock);
+	uint32_t firstObject = firstBlock * BLOCK_SIZE;
+
+	switch (_cullPath)
+	{
+#if defined(SCENE_X86)
+	case CullPath::Avx2:
+		return cullAvx2(frustum.planes, blocks, blockCount, firstObject, visible);
+#endif
+#if defined(SCENE_SSE)
+	case CullPath::Sse:
+		return cullSse(frustum.planes, blocks, blockCount, firstObject, visible);
+#endif
+	default:
+		return cullScalar(frustum.planes, blocks, blockCount, firstObject, visible);
+	}
+}
+
+void Scene::setCullPath(CullPath path)
+{
+	CullPath bestPath = getBestCullPath();
+	_cullPath = static_cast<int>(path) <= static_cast<int>(bestPath) ? path : bestPath;
+}
+
+Scene::CullPath Scene::getBestCullPath()
+{
+#if defined(SCENE_X86)
+	static const bool avx2 = cpuSupportsAvx2();
+	if (avx2) {
+		return CullPath::Avx2;
+	}
+#endif
+#if defined(SCENE_SSE)
+	return CullPath::Sse;
+#else
+	return CullPath::Scalar;
+#endif
+}
+
+const char* Scene::getCullPathName(CullPath path)
+{
+	switch (path)
+	{
+	case CullPath::Avx2: return "AVX2";
+	case CullPath::Sse: return "SSE";
+	default: return "scalar";
+	}
+}
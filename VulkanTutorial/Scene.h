@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Six planes facing inwards, normalized so a plane equation gives the signed distance
+struct Frustum
+{
+	// Left, right, bottom, top, near, far as normal x, y, z and distance
+	float planes[6][4];
+
+	// Volume the vertex shader maps into clip space: x and y in [-1, 1] after the view transform, depth in [0, 1].
+	// view is offset x, offset y, zoom, unused
+	static Frustum fromView(const float view[4]);
+};
+
+// Cullable objects in AoSoA blocks of eight, so one AVX2 register or two SSE registers hold a field of a whole block.
+// Every object is a bounding sphere around a range of instances, which is what it draws when visible
+class Scene
+{
+public:
+	static const uint32_t BLOCK_SIZE = 8;
+
+	enum class CullPath
+	{
+		Scalar,
+		Sse,
+		Avx2
+	};
+
+	Scene() = default;
+
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	// Returns the object index
+	uint32_t addObject(const float center[3], float radius, uint32_t firstInstance, uint32_t instanceCount);
+	void clear();
+
+	// Writes the indices of the objects intersecting the frustum to the front of visible, in object order, and returns
+	// their count. visible is sized for every object, so a vector reused across frames is never reallocated or cleared.
+	// With a job system the blocks are split across its workers. Every path gives the same result
+	uint32_t cull(const Frustum& frustum, std::vector<uint32_t>& visible, JobSystem* jobSystem = nullptr) const;
+
+	// The widest path the CPU supports is picked by default. Unsupported paths fall back to the next narrower one
+	void setCullPath(CullPath path);
+	CullPath getCullPath() const { return _cullPath; }
+	static CullPath getBestCullPath();
+	static const char* getCullPathName(CullPath path);
+
+	uint32_t getObjectCount() const { return _objectCount; }
+	uint32_t getFirstInstance(uint32_t object) const { return _firstInstances[object]; }
+	uint32_t getInstanceCount(uint32_t object) const { return _instanceCounts[object]; }
+
+private:
+	// Padding lanes of the last block have a radius no distance can beat, so they are never visible.
+	// Loaded unaligned, std::vector only honors over-alignment from C++17 on
+	struct Block
+	{
+		float centerX[BLOCK_SIZE];
+		float centerY[BLOCK_SIZE];
+		float centerZ[BLOCK_SIZE];
+		float radius[BLOCK_SIZE];
+	};
+
+	std::vector<Block> _blocks;
+	uint32_t _objectCount = 0;
+
+	// Only read for visible objects while recording, kept apart from the bounds the culling streams through
+	std::vector<uint32_t> _firstInstances;
+	std::vector<uint32_t> _instanceCounts;
+
+	CullPath _cullPath = getBestCullPath();
+
+	uint32_t getBlockCount() const { return (_objectCount + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+	// Culls blocks [firstBlock, firstBlock + blockCount) and returns how many indices were written to visible,
+	// which needs room for BLOCK_SIZE indices per block
+	uint32_t cullBlocks(const Frustum& frustum, uint32_t firstBlock, uint32_t blockCount, uint32_t* visible) const;
+};
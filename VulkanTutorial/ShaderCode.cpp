@@ -0,0 +1,54 @@
+#include "ShaderCode.h"
+
+#include "StartupTracer.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef EMBED_SHADERS
+#include "shaders/EmbeddedShaders.h"
+#endif
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+ShaderCode ShaderCode::load(const std::string& filePath)
+{
+	StartupTracer::Scope scope("ShaderCode::load");
+
+#ifdef EMBED_SHADERS
+	for (const EmbeddedShader& shader : embeddedShaders)
+	{
+		if (filePath == shader.path)
+		{
+			validate(shader.code, shader.size, filePath);
+			return ShaderCode(shader.code, shader.size, MappedFile());
+		}
+	}
+#endif
+
+	MappedFile file = MappedFile::map(filePath);
+	const uint32_t* code = static_cast<const uint32_t*>(file.data());
+	size_t size = file.size();
+	validate(code, size, filePath);
+
+	return ShaderCode(code, size, std::move(file));
+}
+
+ShaderCode::ShaderCode(const uint32_t* code, size_t size, MappedFile file) : _code{ code }, _size{ size }, _file{ std::move(file) }
+{
+}
+
+void ShaderCode::validate(const uint32_t* code, size_t size, const std::string& filePath)
+{
+	if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0) {
+		throw std::runtime_error("Shader code is not aligned to 4 bytes: " + filePath);
+	}
+
+	if (size < sizeof(uint32_t) * 5 || size % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Shader code size is not a multiple of 4 bytes: " + filePath);
+	}
+
+	if (code[0] != SPIRV_MAGIC) {
+		throw std::runtime_error("Shader file is not SPIR-V: " + filePath);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a SPIR-V binary. The words are either memory-mapped straight from
+// the .spv file or, in builds with EMBED_SHADERS, point into data compiled into the executable
+class ShaderCode
+{
+public:
+	static ShaderCode load(const std::string& filePath);
+
+	ShaderCode(ShaderCode&& other) noexcept = default;
+	ShaderCode& operator=(ShaderCode&& other) noexcept = default;
+	ShaderCode(const ShaderCode&) = delete;
+	ShaderCode& operator=(const ShaderCode&) = delete;
+
+	const uint32_t* data() const { return _code; }
+	// Size in bytes, as expected by VkShaderModuleCreateInfo::codeSize
+	size_t size() const { return _size; }
+
+	bool isEmbedded() const { return !_file.isMapped(); }
+
+private:
+	ShaderCode(const uint32_t* code, size_t size, MappedFile file);
+
+	const uint32_t* _code;
+	size_t _size;
+	// Not mapped for embedded code
+	MappedFile _file;
+
+	static void validate(const uint32_t* code, size_t size, const std::string& filePath);
+};
@@ -0,0 +1,154 @@
+#include "StagingRing.h"
+
+#include "Alignment.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+// vkCmdCopyBuffer has no offset requirement, 4 keeps copies on the fast path of most DMA engines
+static const VkDeviceSize BUFFER_ALIGNMENT = 4;
+
+StagingRing::StagingRing(Device& device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame)
+	: _device{ device }, _bytesPerFrame{ alignUp(bytesPerFrame, 256) }
+{
+	// Image offsets must be a multiple of the texel size and 4, 16 covers every uncompressed format
+	_imageAlignment = std::max<VkDeviceSize>(16, _device.getProperties().limits.optimalBufferCopyOffsetAlignment);
+
+	_device.getAllocator().createBuffer(_bytesPerFrame * framesInFlight, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _buffer, _allocation);
+
+	if (!_allocation.mappedData) {
+		throw std::runtime_error("Staging ring memory is not mapped!");
+	}
+
+	_bufferUploads.reserve(64);
+	_imageUploads.reserve(64);
+	_bufferRegions.reserve(64);
+	_imageRegions.reserve(64);
+}
+
+StagingRing::~StagingRing()
+{
+	_device.getAllocator().destroyBuffer(_buffer, _allocation);
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex)
+{
+	_frameRegion.reset(_bytesPerFrame * frameIndex, _bytesPerFrame);
+
+	_bufferUploads.clear();
+	_imageUploads.clear();
+}
+
+VkDeviceSize StagingRing::write(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset;
+	if (!_frameRegion.allocate(size, alignment, offset)) {
+		throw std::runtime_error("Staging ring frame region is full!");
+	}
+
+	std::memcpy(static_cast<char*>(_allocation.mappedData) + offset, data, static_cast<size_t>(size));
+
+	return offset;
+}
+
+void StagingRing::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	VkDeviceSize srcOffset = write(data, size, BUFFER_ALIGNMENT);
+
+	// Consecutive writes into consecutive destination bytes grow the previous copy
+	if (!_bufferUploads.empty())
+	{
+		BufferUpload& previous = _bufferUploads.back();
+		if (previous.dstBuffer == dstBuffer && previous.region.srcOffset + previous.region.size == srcOffset
+			&& previous.region.dstOffset + previous.region.size == dstOffset)
+		{
+			previous.region.size += size;
+			return;
+		}
+	}
+
+	BufferUpload upload;
+	upload.dstBuffer = dstBuffer;
+	upload.region.srcOffset = srcOffset;
+	upload.region.dstOffset = dstOffset;
+	upload.region.size = size;
+	_bufferUploads.push_back(upload);
+}
+
+void StagingRing::uploadImage(VkImage dstImage, VkBufferImageCopy region, const void* data, VkDeviceSize size)
+{
+	region.bufferOffset = write(data, size, _imageAlignment);
+
+	ImageUpload upload;
+	upload.dstImage = dstImage;
+	upload.region = region;
+	_imageUploads.push_back(upload);
+}
+
+void StagingRing::recordCopies(VkCommandBuffer commandBuffer)
+{
+	_uploadCount = static_cast<uint32_t>(_bufferUploads.size() + _imageUploads.size());
+	_copyCommandCount = 0;
+
+	if (_bufferUploads.empty() && _imageUploads.empty()) {
+		return;
+	}
+
+	_frameRegion.flush(_device.getAllocator(), _allocation);
+
+	// One command per destination with all of its regions
+	std::stable_sort(_bufferUploads.begin(), _bufferUploads.end(),
+		[](const BufferUpload& a, const BufferUpload& b) { return std::less<VkBuffer>()(a.dstBuffer, b.dstBuffer); });
+
+	for (size_t first = 0; first < _bufferUploads.size();)
+	{
+		VkBuffer dstBuffer = _bufferUploads[first].dstBuffer;
+
+		_bufferRegions.clear();
+		size_t last = first;
+		for (; last < _bufferUploads.size() && _bufferUploads[last].dstBuffer == dstBuffer; ++last) {
+			_bufferRegions.push_back(_bufferUploads[last].region);
+		}
+
+		vkCmdCopyBuffer(commandBuffer, _buffer, dstBuffer, static_cast<uint32_t>(_bufferRegions.size()), _bufferRegions.data());
+		++_copyCommandCount;
+		first = last;
+	}
+
+	std::stable_sort(_imageUploads.begin(), _imageUploads.end(),
+		[](const ImageUpload& a, const ImageUpload& b) { return std::less<VkImage>()(a.dstImage, b.dstImage); });
+
+	for (size_t first = 0; first < _imageUploads.size();)
+	{
+		VkImage dstImage = _imageUploads[first].dstImage;
+
+		_imageRegions.clear();
+		size_t last = first;
+		for (; last < _imageUploads.size() && _imageUploads[last].dstImage == dstImage; ++last) {
+			_imageRegions.push_back(_imageUploads[last].region);
+		}
+
+		vkCmdCopyBufferToImage(commandBuffer, _buffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(_imageRegions.size()), _imageRegions.data());
+		++_copyCommandCount;
+		first = last;
+	}
+
+	VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	_bufferUploads.clear();
+	_imageUploads.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Device.h"
+#include "RingRegion.h"
+
+#include <vector>
+
+// Persistently mapped upload memory split into one region per frame in flight. Uploads only copy
+// into the current region and queue a transfer, so streaming per-frame data neither allocates nor waits
+class StagingRing
+{
+public:
+	StagingRing(Device& device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame);
+	~StagingRing();
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	// Rewinds the region of the frame slot. Call once the slot's previous frame has finished,
+	// which SwapChain::acquireNextImage guarantees
+	void beginFrame(uint32_t frameIndex);
+
+	// Copies data into the ring and queues a copy into dstBuffer. Throws when the frame region is full.
+	// The destination must not be read by frames still in flight
+	void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// Same for an image in TRANSFER_DST_OPTIMAL layout, region.bufferOffset is filled in here
+	void uploadImage(VkImage dstImage, VkBufferImageCopy region, const void* data, VkDeviceSize size);
+
+	// Records the queued copies, merged per destination, followed by a barrier to vertex, index,
+	// uniform and shader reads. Must be recorded outside a render pass
+	void recordCopies(VkCommandBuffer commandBuffer);
+
+	VkDeviceSize getBytesPerFrame() const { return _bytesPerFrame; }
+	// Statistics of the last recordCopies
+	uint32_t getCopyCommandCount() const { return _copyCommandCount; }
+	uint32_t getUploadCount() const { return _uploadCount; }
+
+private:
+	struct BufferUpload
+	{
+		VkBuffer dstBuffer;
+		VkBufferCopy region;
+	};
+
+	struct ImageUpload
+	{
+		VkImage dstImage;
+		VkBufferImageCopy region;
+	};
+
+	Device& _device;
+	VkDeviceSize _bytesPerFrame;
+	VkDeviceSize _imageAlignment;
+
+	VkBuffer _buffer;
+	Allocation _allocation;
+
+	RingRegion _frameRegion;
+
+	// Kept between frames so their capacity is reused
+	std::vector<BufferUpload> _bufferUploads;
+	std::vector<ImageUpload> _imageUploads;
+	std::vector<VkBufferCopy> _bufferRegions;
+	std::vector<VkBufferImageCopy> _imageRegions;
+
+	uint32_t _copyCommandCount = 0;
+	uint32_t _uploadCount = 0;
+
+	// Returns the ring offset of size bytes written from data
+	VkDeviceSize write(const void* data, VkDeviceSize size, VkDeviceSize alignment);
+};
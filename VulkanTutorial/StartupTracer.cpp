@@ -0,0 +1,115 @@
+#include "StartupTracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+std::atomic<StartupTracer*> StartupTracer::_active{ nullptr };
+
+// Nesting depth of the scopes open on the calling thread
+static thread_local uint32_t openScopeCount = 0;
+
+StartupTracer::StartupTracer(double thresholdMilliseconds) : _thresholdMilliseconds{ thresholdMilliseconds }, _startTime{ Clock::now() }
+{
+}
+
+StartupTracer::~StartupTracer()
+{
+	StartupTracer* self = this;
+	_active.compare_exchange_strong(self, nullptr);
+}
+
+void StartupTracer::setActive(StartupTracer* tracer)
+{
+	_active = tracer;
+}
+
+StartupTracer::Scope::Scope(const char* name, Kind kind) : _tracer{ _active }, _name{ name }, _kind{ kind }, _depth{ 0 }
+{
+	if (_tracer)
+	{
+		_depth = openScopeCount++;
+		_start = Clock::now();
+	}
+}
+
+StartupTracer::Scope::~Scope()
+{
+	if (_tracer)
+	{
+		--openScopeCount;
+		_tracer->addEvent(_name, _kind, _depth, _start, Clock::now());
+	}
+}
+
+void StartupTracer::addEvent(const char* name, Kind kind, uint32_t depth, Clock::time_point start, Clock::time_point end)
+{
+	Event event;
+	event.name = name;
+	event.kind = kind;
+	event.depth = depth;
+	event.startUs = std::chrono::duration<double, std::micro>(start - _startTime).count();
+	event.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::thread::id threadId = std::this_thread::get_id();
+	auto thread = std::find(_threads.begin(), _threads.end(), threadId);
+	if (thread == _threads.end()) {
+		thread = _threads.insert(_threads.end(), threadId);
+	}
+	event.thread = static_cast<uint32_t>(thread - _threads.begin());
+
+	_events.push_back(event);
+}
+
+void StartupTracer::writeTrace(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open startup trace file!");
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	file << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < _threads.size(); ++i)
+	{
+		file << (i > 0 ? ",\n" : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << (i == 0 ? "main" : "worker") << "\"}}";
+	}
+	for (const Event& event : _events)
+	{
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.kind == Kind::Phase ? "phase" : "driver")
+			<< "\",\"ph\":\"X\",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+			<< ",\"pid\":0,\"tid\":" << event.thread << "}";
+	}
+	file << "\n]}\n";
+}
+
+void StartupTracer::printSummary(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Scopes are recorded when they close, so parents come after their children
+	std::vector<Event> events = _events;
+	std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+	{
+		return a.thread != b.thread ? a.thread < b.thread : a.startUs < b.startUs;
+	});
+
+	uint32_t slowCount = 0;
+	out << "Startup trace, threshold " << _thresholdMilliseconds << " ms:" << std::endl;
+	for (const Event& event : events)
+	{
+		double milliseconds = event.durationUs / 1000.0;
+		bool slow = milliseconds > _thresholdMilliseconds;
+		slowCount += slow ? 1 : 0;
+
+		out << (slow ? "  SLOW " : "       ") << "[" << event.thread << "] " << std::string(event.depth * 2, ' ')
+			<< event.name << (event.kind == Kind::DriverCall ? " (driver)" : "") << ": "
+			<< std::fixed << std::setprecision(3) << milliseconds << std::defaultfloat << " ms" << std::endl;
+	}
+	out << slowCount << " of " << events.size() << " startup scopes above " << _thresholdMilliseconds << " ms" << std::endl;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Times the startup phases and the driver calls inside them. Scopes may be opened from any thread,
+// every thread gets its own row in the timeline. Scopes record into the active tracer, without one
+// they cost a null check, so they can stay in code that also runs after startup
+class StartupTracer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Kind
+	{
+		Phase,
+		DriverCall
+	};
+
+	// Scopes slower than thresholdMilliseconds are flagged in the summary
+	explicit StartupTracer(double thresholdMilliseconds);
+	~StartupTracer();
+
+	StartupTracer(const StartupTracer&) = delete;
+	StartupTracer& operator=(const StartupTracer&) = delete;
+
+	// One tracer at a time, nullptr stops tracing
+	static void setActive(StartupTracer* tracer);
+
+	class Scope
+	{
+	public:
+		// Names must outlive the tracer, string literals are expected
+		explicit Scope(const char* name, Kind kind = Kind::Phase);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		StartupTracer* _tracer;
+		const char* _name;
+		Kind _kind;
+		uint32_t _depth;
+		Clock::time_point _start;
+	};
+
+	// Timeline in the Chrome trace event format (chrome://tracing)
+	void writeTrace(const std::string& filePath) const;
+	// Every scope in start order, nested by depth, with the slow ones flagged
+	void printSummary(std::ostream& out) const;
+
+private:
+	struct Event
+	{
+		const char* name;
+		Kind kind;
+		uint32_t thread;
+		uint32_t depth;
+		double startUs;
+		double durationUs;
+	};
+
+	static std::atomic<StartupTracer*> _active;
+
+	double _thresholdMilliseconds;
+	Clock::time_point _startTime;
+
+	mutable std::mutex _mutex;
+	std::vector<Event> _events;
+	// Index in this list is the timeline row of the thread
+	std::vector<std::thread::id> _threads;
+
+	void addEvent(const char* name, Kind kind, uint32_t depth, Clock::time_point start, Clock::time_point end);
+};
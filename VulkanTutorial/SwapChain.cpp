@@ -1 +1,767 @@
 #include "SwapChain.h"
+
+#include "StartupTracer.h"
+
+#include <algorithm>
+
+SwapChain::SwapChain(Device& device, VkExtent2D windowExtent, uint32_t framesInFlight, VkPresentModeKHR presentMode, uint32_t imageCount,
+	bool dynamicRendering, VkSampleCountFlagBits sampleCount)
+	: _device{ device }, _windowExtent{ windowExtent }, _dynamicRendering{ dynamicRendering && device.supportsDynamicRendering() },
+	_framesInFlight{ framesInFlight }, _requestedPresentMode{ presentMode }, _requestedImageCount{ imageCount }
+{
+	StartupTracer::Scope scope("SwapChain::SwapChain");
+
+	if (_framesInFlight == 0) {
+		throw std::runtime_error("Frames in flight count must be at least 1!");
+	}
+
+	if (_device.isHeadless()) {
+		createOffscreenImages();
+	}
+	else {
+		createSwapchain();
+	}
+	createImageViews();
+	_depthFormat = chooseDepthFormat();
+	_sampleCount = chooseSampleCount(sampleCount);
+	createAttachments();
+	if (!_dynamicRendering) {
+		createRenderPass();
+	}
+	createFramebuffers();
+	createSyncObjects();
+}
+
+SwapChain::~SwapChain()
+{
+	VkDevice device = _device.getDevice();
+
+	for (uint32_t i = 0; i < _framesInFlight; ++i)
+	{
+		vkDestroySemaphore(device, _imageAvailableSemaphores[i], nullptr);
+		vkDestroySemaphore(device, _renderFinishedSemaphores[i], nullptr);
+	}
+
+	destroyImageResources();
+	if (_renderPass != VK_NULL_HANDLE) {
+		vkDestroyRenderPass(device, _renderPass, nullptr);
+	}
+
+	if (_swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(device, _swapchain, nullptr);
+	}
+	else
+	{
+		for (size_t i = 0; i < _images.size(); ++i)
+		{
+			_device.getAllocator().destroyImage(_images[i], _imageAllocations[i]);
+		}
+	}
+}
+
+VkResult SwapChain::acquireNextImage(uint32_t* imageIndex)
+{
+	collectLatencies();
+	_device.waitTimeline(QueueType::Graphic, _frameValues[_currentFrame]);
+	collectLatency(_currentFrame);
+
+	VkResult result = VK_SUCCESS;
+
+	// Every frame slot owns one offscreen image, so there is nothing to acquire
+	if (_device.isHeadless()) {
+		*imageIndex = _currentFrame;
+	}
+	else {
+		result = vkAcquireNextImageKHR(_device.getDevice(), _swapchain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, imageIndex);
+	}
+
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		return result;
+	}
+
+	// With fewer images than frames in flight an image can still be in use by an older frame
+	_device.waitTimeline(QueueType::Graphic, _imageValues[*imageIndex]);
+
+	return result;
+}
+
+void SwapChain::submitCommandBuffers(const VkCommandBuffer* commandBuffer, uint32_t imageIndex,
+	VkSemaphore waitTimeline, uint64_t waitValue, VkPipelineStageFlags waitStage)
+{
+	// Values of binary semaphores are ignored, their slots in the value arrays are placeholders
+	VkSemaphore waitSemaphores[2];
+	uint64_t waitValues[2] = {};
+	VkPipelineStageFlags waitStages[2];
+	uint32_t waitCount = 0;
+
+	if (!_device.isHeadless())
+	{
+		waitSemaphores[waitCount] = _imageAvailableSemaphores[_currentFrame];
+		waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	}
+	if (waitTimeline != VK_NULL_HANDLE)
+	{
+		waitSemaphores[waitCount] = waitTimeline;
+		waitValues[waitCount] = waitValue;
+		waitStages[waitCount++] = waitStage;
+	}
+
+	uint64_t frameValue = _device.nextTimelineValue(QueueType::Graphic);
+
+	VkSemaphore signalSemaphores[2] = { _device.getTimeline(QueueType::Graphic), VK_NULL_HANDLE };
+	uint64_t signalValues[2] = { frameValue, 0 };
+	uint32_t signalCount = 1;
+
+	// The swapchain only accepts binary semaphores for presentation
+	if (!_device.isHeadless()) {
+		signalSemaphores[signalCount++] = _renderFinishedSemaphores[_currentFrame];
+	}
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = signalCount;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = commandBuffer;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.signalSemaphoreCount = signalCount;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	if (vkQueueSubmit(_device.getGraphicQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit draw command buffer!");
+	}
+
+	_frameValues[_currentFrame] = frameValue;
+	_imageValues[imageIndex] = frameValue;
+	_latencyPending[_currentFrame] = _inputMarked[_currentFrame];
+	_inputMarked[_currentFrame] = false;
+}
+
+void SwapChain::recreate(VkExtent2D windowExtent)
+{
+	// Frames in flight may still render into the old images through their views and framebuffers
+	_device.waitTimeline(QueueType::Graphic, _device.getLastTimelineValue(QueueType::Graphic));
+	collectLatencies();
+
+	destroyImageResources();
+
+	_windowExtent = windowExtent;
+	createSwapchain();
+	createImageViews();
+	createAttachments();
+	createFramebuffers();
+
+	_imageValues.assign(_images.size(), 0);
+}
+
+void SwapChain::waitForLastSubmittedFrame()
+{
+	_device.waitTimeline(QueueType::Graphic, _device.getLastTimelineValue(QueueType::Graphic));
+	collectLatencies();
+}
+
+void SwapChain::markInput()
+{
+	_inputTimes[_currentFrame] = std::chrono::steady_clock::now();
+	_inputMarked[_currentFrame] = true;
+}
+
+void SwapChain::collectLatency(uint32_t frameIndex)
+{
+	if (!_latencyPending[frameIndex] || !_device.isTimelineReached(QueueType::Graphic, _frameValues[frameIndex])) {
+		return;
+	}
+	_latencyPending[frameIndex] = false;
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _inputTimes[frameIndex]).count();
+
+	if (_latencyStats.frameCount == 0)
+	{
+		_latencyStats.minimumMilliseconds = milliseconds;
+		_latencyStats.maximumMilliseconds = milliseconds;
+	}
+	else
+	{
+		_latencyStats.minimumMilliseconds = std::min(_latencyStats.minimumMilliseconds, milliseconds);
+		_latencyStats.maximumMilliseconds = std::max(_latencyStats.maximumMilliseconds, milliseconds);
+	}
+	_latencyStats.totalMilliseconds += milliseconds;
+	++_latencyStats.frameCount;
+}
+
+// Polled between blocking calls, a frame finishing while the CPU is busy is seen at most one poll late
+void SwapChain::collectLatencies()
+{
+	for (uint32_t i = 0; i < _framesInFlight; ++i) {
+		collectLatency(i);
+	}
+}
+
+VkResult SwapChain::present(uint32_t imageIndex)
+{
+	if (_device.isHeadless())
+	{
+		collectLatencies();
+		_currentFrame = (_currentFrame + 1) % _framesInFlight;
+		return VK_SUCCESS;
+	}
+
+	VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &_renderFinishedSemaphores[_currentFrame];
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &_swapchain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	VkResult result = vkQueuePresentKHR(_device.getPresentQueue(), &presentInfo);
+
+	collectLatencies();
+	_currentFrame = (_currentFrame + 1) % _framesInFlight;
+
+	return result;
+}
+
+void SwapChain::createSwapchain()
+{
+	QueueFamilyIndices indices = _device.getQueueFamilies();
+	uint32_t queueFamilyIndices[] = { static_cast<uint32_t>(indices.graphicFamily), static_cast<uint32_t>(indices.presentFamily) };
+
+	SwapChainSupportDetails support = _device.getSwapChainSupport();
+	_presentMode = choosePresentMode(support.presentModes);
+
+	_imageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+	_extent = chooseExtent(support.capabilities);
+
+	VkSwapchainCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+	createInfo.surface = _device.getSurface();
+	createInfo.minImageCount = chooseImageCount(support.capabilities);
+	createInfo.imageFormat = _imageFormat;
+	createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+	createInfo.imageExtent = _extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (indices.graphicFamily != indices.presentFamily)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else {
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = _presentMode;
+	createInfo.clipped = VK_TRUE;
+	// Lets the presentation engine keep showing the old images until the new ones are ready
+	createInfo.oldSwapchain = _swapchain;
+
+	VkSwapchainKHR swapchain;
+	VkResult result;
+	{
+		StartupTracer::Scope callScope("vkCreateSwapchainKHR", StartupTracer::Kind::DriverCall);
+		result = vkCreateSwapchainKHR(_device.getDevice(), &createInfo, nullptr, &swapchain);
+	}
+
+	// The old swapchain is retired even when creation fails
+	if (_swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(_device.getDevice(), _swapchain, nullptr);
+	}
+	_swapchain = result == VK_SUCCESS ? swapchain : VK_NULL_HANDLE;
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create swapchain!");
+	}
+
+	uint32_t swapchainImageCount;
+	vkGetSwapchainImagesKHR(_device.getDevice(), _swapchain, &swapchainImageCount, nullptr);
+	_images.resize(swapchainImageCount);
+	vkGetSwapchainImagesKHR(_device.getDevice(), _swapchain, &swapchainImageCount, _images.data());
+}
+
+VkPresentModeKHR SwapChain::choosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const
+{
+	for (VkPresentModeKHR presentMode : availablePresentModes)
+	{
+		if (presentMode == _requestedPresentMode) {
+			return presentMode;
+		}
+	}
+
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkExtent2D SwapChain::chooseExtent(const VkSurfaceCapabilitiesKHR& capabilities) const
+{
+	// Most platforms dictate the window size, the others leave it to the swapchain within the limits
+	if (capabilities.currentExtent.width != UINT32_MAX) {
+		return capabilities.currentExtent;
+	}
+
+	VkExtent2D extent = _windowExtent;
+	extent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, extent.width));
+	extent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, extent.height));
+
+	return extent;
+}
+
+uint32_t SwapChain::chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const
+{
+	// One above the minimum lets the app acquire while the presentation engine holds the others
+	uint32_t imageCount = _requestedImageCount > 0 ? _requestedImageCount : capabilities.minImageCount + 1;
+
+	imageCount = std::max(imageCount, capabilities.minImageCount);
+	if (capabilities.maxImageCount > 0) {
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	}
+
+	return imageCount;
+}
+
+void SwapChain::createOffscreenImages()
+{
+	_imageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+	_extent = _windowExtent;
+
+	_images.resize(_framesInFlight);
+	_imageAllocations.resize(_framesInFlight);
+
+	for (uint32_t i = 0; i < _framesInFlight; ++i)
+	{
+		VkImageCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = _imageFormat;
+		createInfo.extent = { _extent.width, _extent.height, 1 };
+		createInfo.mipLevels = 1;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		_device.getAllocator().createImage(createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _images[i], _imageAllocations[i]);
+	}
+}
+
+void SwapChain::createImageViews()
+{
+	_imageViews.resize(_images.size());
+
+	for (size_t i = 0; i < _images.size(); ++i)
+	{
+		VkImageViewCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+		createInfo.image = _images[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = _imageFormat;
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(_device.getDevice(), &createInfo, nullptr, &_imageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create image view!");
+		}
+	}
+}
+
+VkFormat SwapChain::chooseDepthFormat()
+{
+	// Stencil is unused, the combined formats are only fallbacks
+	return _device.findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+		VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
+
+// Views and barriers of combined depth stencil images have to name both aspects
+VkImageAspectFlags SwapChain::getDepthAspect() const
+{
+	if (_depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || _depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+
+	return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+VkSampleCountFlagBits SwapChain::chooseSampleCount(VkSampleCountFlagBits requestedSampleCount)
+{
+	// Color and depth attachments of one subpass must share the sample count
+	VkPhysicalDeviceLimits limits = _device.getProperties().limits;
+	VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+	for (uint32_t count = requestedSampleCount; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+	{
+		if (supported & count) {
+			return static_cast<VkSampleCountFlagBits>(count);
+		}
+	}
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+void SwapChain::createAttachments()
+{
+	_lazilyAllocated = true;
+	createAttachmentImage(_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, getDepthAspect(), _depthImage, _depthAllocation, _depthImageView);
+
+	if (_sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		createAttachmentImage(_imageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, _colorImage, _colorAllocation, _colorImageView);
+	}
+}
+
+// Nothing is loaded from or stored to these images, so on a tiler they can live entirely in tile memory
+void SwapChain::createAttachmentImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+	VkImage& image, Allocation& allocation, VkImageView& imageView)
+{
+	VkImageCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = format;
+	createInfo.extent = { _extent.width, _extent.height, 1 };
+	createInfo.mipLevels = 1;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = _sampleCount;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	MemoryAllocator& allocator = _device.getAllocator();
+	allocator.createImage(createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+	_lazilyAllocated &= (allocator.getMemoryProperties().memoryTypes[allocation.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+
+	VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspect;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(_device.getDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create attachment image view!");
+	}
+}
+
+// Attachment 0 is the color target and 1 the depth. With MSAA the color target is the multisampled
+// image and the swapchain image follows as attachment 2, written only by the resolve at the end of the subpass
+void SwapChain::createRenderPass()
+{
+	bool multisampled = _sampleCount != VK_SAMPLE_COUNT_1_BIT;
+	// Offscreen images are left ready to be copied out instead of presented
+	VkImageLayout finalLayout = _device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = _imageFormat;
+	colorAttachment.samples = _sampleCount;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : finalLayout;
+
+	VkAttachmentDescription resolveAttachment{};
+	resolveAttachment.format = _imageFormat;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachment.finalLayout = finalLayout;
+
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = _depthFormat;
+	depthAttachment.samples = _sampleCount;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference resolveAttachmentRef{};
+	resolveAttachmentRef.attachment = 2;
+	resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// The image is acquired asynchronously, so the layout transition has to wait for
+	// the acquire semaphore that is waited at the color attachment output stage.
+	// The clears have to wait for the previous frame's writes to the shared depth and multisampled images
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, resolveAttachment };
+
+	VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+	createInfo.attachmentCount = multisampled ? 3 : 2;
+	createInfo.pAttachments = attachments;
+	createInfo.subpassCount = 1;
+	createInfo.pSubpasses = &subpass;
+	createInfo.dependencyCount = 1;
+	createInfo.pDependencies = &dependency;
+
+	if (vkCreateRenderPass(_device.getDevice(), &createInfo, nullptr, &_renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create render pass!");
+	}
+}
+
+// Framebuffers are created on first use, so a burst of resizes only builds the ones actually drawn to
+void SwapChain::createFramebuffers()
+{
+	if (!_dynamicRendering) {
+		_framebuffers.assign(_imageViews.size(), VK_NULL_HANDLE);
+	}
+}
+
+void SwapChain::beginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const VkClearValue& clearValue, bool secondaryContents)
+{
+	VkClearValue clearValues[2] = { clearValue, {} };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	if (!_dynamicRendering)
+	{
+		VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		beginInfo.renderPass = _renderPass;
+		beginInfo.framebuffer = getFramebuffer(imageIndex);
+		beginInfo.renderArea.extent = _extent;
+		beginInfo.clearValueCount = 2;
+		beginInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+		return;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	transitionImage(commandBuffer, imageIndex, true);
+
+	VkRenderingAttachmentInfoKHR colorAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR };
+	colorAttachment.imageView = _imageViews[imageIndex];
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.clearValue = clearValue;
+	if (_sampleCount != VK_SAMPLE_COUNT_1_BIT)
+	{
+		colorAttachment.imageView = _colorImageView;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+		colorAttachment.resolveImageView = _imageViews[imageIndex];
+		colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	VkRenderingAttachmentInfoKHR depthAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR };
+	depthAttachment.imageView = _depthImageView;
+	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue = clearValues[1];
+
+	VkRenderingInfoKHR renderingInfo = { VK_STRUCTURE_TYPE_RENDERING_INFO_KHR };
+	renderingInfo.flags = secondaryContents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+	renderingInfo.renderArea.extent = _extent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+
+	_device.cmdBeginRendering(commandBuffer, renderingInfo);
+#endif
+}
+
+void SwapChain::endRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	if (!_dynamicRendering)
+	{
+		vkCmdEndRenderPass(commandBuffer);
+		return;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	_device.cmdEndRendering(commandBuffer);
+	transitionImage(commandBuffer, imageIndex, false);
+#endif
+}
+
+const VkCommandBufferInheritanceInfo& SwapChain::getInheritanceInfo(uint32_t imageIndex)
+{
+	_inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+
+	if (!_dynamicRendering)
+	{
+		_inheritanceInfo.renderPass = _renderPass;
+		_inheritanceInfo.subpass = 0;
+		_inheritanceInfo.framebuffer = getFramebuffer(imageIndex);
+		return _inheritanceInfo;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	_inheritanceRenderingInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+	_inheritanceRenderingInfo.colorAttachmentCount = 1;
+	_inheritanceRenderingInfo.pColorAttachmentFormats = &_imageFormat;
+	_inheritanceRenderingInfo.depthAttachmentFormat = _depthFormat;
+	_inheritanceRenderingInfo.rasterizationSamples = _sampleCount;
+
+	_inheritanceInfo.pNext = &_inheritanceRenderingInfo;
+#endif
+	return _inheritanceInfo;
+}
+
+void SwapChain::transitionImage(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool toAttachment)
+{
+	VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _images[imageIndex];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	// Same stages as the render pass: the transition in waits for the acquire semaphore at color output,
+	// the transition out is followed by the present or copy that waits on the frame's semaphores
+	VkImageLayout finalLayout = _device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	if (toAttachment)
+	{
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	}
+	else
+	{
+		barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.newLayout = finalLayout;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	}
+
+	VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkPipelineStageFlags dstStage = toAttachment ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+	if (!toAttachment)
+	{
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		return;
+	}
+
+	// The depth contents are discarded, the barrier only orders the clear after the previous frame's depth tests
+	VkImageMemoryBarrier depthBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = _depthImage;
+	depthBarrier.subresourceRange.aspectMask = getDepthAspect();
+	depthBarrier.subresourceRange.levelCount = 1;
+	depthBarrier.subresourceRange.layerCount = 1;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// Same for the multisampled image, which the previous frame wrote at color attachment output
+	VkImageMemoryBarrier colorBarrier = barrier;
+	colorBarrier.image = _colorImage;
+	colorBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	VkImageMemoryBarrier barriers[] = { barrier, depthBarrier, colorBarrier };
+	srcStage |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dstStage |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, _colorImage != VK_NULL_HANDLE ? 3 : 2, barriers);
+}
+
+VkFramebuffer SwapChain::getFramebuffer(uint32_t index)
+{
+	if (_framebuffers[index] != VK_NULL_HANDLE) {
+		return _framebuffers[index];
+	}
+
+	// Same order as the render pass attachments
+	bool multisampled = _sampleCount != VK_SAMPLE_COUNT_1_BIT;
+	VkImageView attachments[] = { multisampled ? _colorImageView : _imageViews[index], _depthImageView, _imageViews[index] };
+
+	VkFramebufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+	createInfo.renderPass = _renderPass;
+	createInfo.attachmentCount = multisampled ? 3 : 2;
+	createInfo.pAttachments = attachments;
+	createInfo.width = _extent.width;
+	createInfo.height = _extent.height;
+	createInfo.layers = 1;
+
+	if (vkCreateFramebuffer(_device.getDevice(), &createInfo, nullptr, &_framebuffers[index]) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create framebuffer!");
+	}
+
+	return _framebuffers[index];
+}
+
+void SwapChain::destroyImageResources()
+{
+	for (VkFramebuffer framebuffer : _framebuffers) {
+		vkDestroyFramebuffer(_device.getDevice(), framebuffer, nullptr);
+	}
+	_framebuffers.clear();
+
+	for (VkImageView imageView : _imageViews) {
+		vkDestroyImageView(_device.getDevice(), imageView, nullptr);
+	}
+	_imageViews.clear();
+
+	if (_depthImage != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(_device.getDevice(), _depthImageView, nullptr);
+		_device.getAllocator().destroyImage(_depthImage, _depthAllocation);
+		_depthImageView = VK_NULL_HANDLE;
+		_depthImage = VK_NULL_HANDLE;
+	}
+
+	if (_colorImage != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(_device.getDevice(), _colorImageView, nullptr);
+		_device.getAllocator().destroyImage(_colorImage, _colorAllocation);
+		_colorImageView = VK_NULL_HANDLE;
+		_colorImage = VK_NULL_HANDLE;
+	}
+}
+
+void SwapChain::createSyncObjects()
+{
+	_imageAvailableSemaphores.resize(_framesInFlight);
+	_renderFinishedSemaphores.resize(_framesInFlight);
+	_frameValues.resize(_framesInFlight, 0);
+	_inputTimes.resize(_framesInFlight);
+	_inputMarked.resize(_framesInFlight, false);
+	_latencyPending.resize(_framesInFlight, false);
+	_imageValues.resize(_images.size(), 0);
+
+	VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+
+	for (uint32_t i = 0; i < _framesInFlight; ++i)
+	{
+		if (vkCreateSemaphore(_device.getDevice(), &semaphoreInfo, nullptr, &_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(_device.getDevice(), &semaphoreInfo, nullptr, &_renderFinishedSemaphores[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create synchronization objects for a frame!");
+		}
+	}
+}
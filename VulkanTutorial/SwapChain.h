@@ -2,21 +2,164 @@
 
 #include "Device.h"
 
+#include <chrono>
+
 class SwapChain
 {
 public:
-	SwapChain();
+	static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+	// Input to present latency of the frames seen so far
+	struct LatencyStats
+	{
+		uint32_t frameCount = 0;
+		double totalMilliseconds = 0.0;
+		double minimumMilliseconds = 0.0;
+		double maximumMilliseconds = 0.0;
+	};
+
+	// An imageCount of 0 picks one above the surface minimum, other counts are clamped to the surface limits.
+	// dynamicRendering replaces the render pass and framebuffers when the device supports it.
+	// sampleCount is lowered to the highest count the device supports for both color and depth
+	SwapChain(Device& device, VkExtent2D windowExtent, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT,
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR, uint32_t imageCount = 0, bool dynamicRendering = false,
+		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT);
 	~SwapChain();
 
+	SwapChain(const SwapChain&) = delete;
+	SwapChain& operator=(const SwapChain&) = delete;
+
+	// VK_NULL_HANDLE with dynamic rendering
+	VkRenderPass getRenderPass() { return _renderPass; }
+	// Created on first use after construction or recreate, render pass path only
+	VkFramebuffer getFramebuffer(uint32_t index);
+	bool usesDynamicRendering() const { return _dynamicRendering; }
+
+	// Starts drawing into the image through whichever path is active, clearing the color to clearValue and
+	// the depth to 1. With dynamic rendering the images are transitioned with explicit barriers.
+	// secondaryContents expects vkCmdExecuteCommands inside
+	void beginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const VkClearValue& clearValue, bool secondaryContents);
+	void endRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	// For secondary command buffers executed between beginRendering and endRendering.
+	// Valid until the next call or recreate
+	const VkCommandBufferInheritanceInfo& getInheritanceInfo(uint32_t imageIndex);
+	VkExtent2D getExtent() const { return _extent; }
+	VkFormat getImageFormat() const { return _imageFormat; }
+	VkFormat getDepthFormat() const { return _depthFormat; }
+	VkSampleCountFlagBits getSampleCount() const { return _sampleCount; }
+	// True when the depth and multisampled color attachments live in lazily allocated memory,
+	// which tile-based GPUs never back with physical pages
+	bool hasLazilyAllocatedAttachments() const { return _lazilyAllocated; }
+	size_t imageCount() const { return _images.size(); }
+
+	// FIFO, the only mode every surface supports, replaces a requested mode the surface lacks
+	VkPresentModeKHR getPresentMode() const { return _presentMode; }
+
+	uint32_t getFramesInFlight() const { return _framesInFlight; }
+	uint32_t getCurrentFrame() const { return _currentFrame; }
+
+	// Rebuilds the swapchain images for a new window size, handing the old swapchain over. The render pass
+	// and image format stay the same, so pipelines remain valid. Windowed mode only
+	void recreate(VkExtent2D windowExtent);
+
+	// Waits until the current frame slot is free on the GPU, then acquires the next image.
+	// On success the previous frame rendering into that image has finished as well
+	VkResult acquireNextImage(uint32_t* imageIndex);
+	// Submits the frame recorded for the current slot, signaling the next graphic timeline value.
+	// waitTimeline is an optional timeline semaphore of another queue whose work the frame consumes
+	void submitCommandBuffers(const VkCommandBuffer* commandBuffer, uint32_t imageIndex,
+		VkSemaphore waitTimeline = VK_NULL_HANDLE, uint64_t waitValue = 0, VkPipelineStageFlags waitStage = 0);
+	// Presents the submitted image and advances to the next frame slot
+	VkResult present(uint32_t imageIndex);
+
+	// Low-latency pacing. Blocks until the GPU has finished the last submitted frame, so the next
+	// frame samples its input as late as possible instead of queueing behind older frames
+	void waitForLastSubmittedFrame();
+
+	// Stamps the input of the frame in the current slot. Its latency is taken once the slot's timeline value is
+	// seen reached, that is when the GPU finished rendering it; scan-out adds up to one refresh
+	void markInput();
+	const LatencyStats& getLatencyStats() const { return _latencyStats; }
+
 private:
-	VkSwapchainKHR _swapchain;
+	Device& _device;
+	VkExtent2D _windowExtent;
+
+	VkSwapchainKHR _swapchain = VK_NULL_HANDLE;
+	VkFormat _imageFormat;
+	VkExtent2D _extent;
 	std::vector<VkImage> _images;
+	// Backing memory of the offscreen images used instead of a swapchain on a headless device
+	std::vector<Allocation> _imageAllocations;
 	std::vector<VkImageView> _imageViews;
 	std::vector<VkFramebuffer> _framebuffers;
 
-	VkSemaphore _imageAvailableSemaphore;
-	VkSemaphore _renderFinishedSemaphore;
+	// Shared by all frames in flight, the render pass dependency orders their writes on the one graphic queue.
+	// Never stored, so they are transient attachments whose contents do not outlive the frame
+	VkFormat _depthFormat;
+	VkImage _depthImage = VK_NULL_HANDLE;
+	Allocation _depthAllocation;
+	VkImageView _depthImageView = VK_NULL_HANDLE;
+	// Multisampled color target resolved into the swapchain image at the end of the subpass, MSAA only
+	VkImage _colorImage = VK_NULL_HANDLE;
+	Allocation _colorAllocation;
+	VkImageView _colorImageView = VK_NULL_HANDLE;
 
-	VkFence _fence;
-};
+	VkSampleCountFlagBits _sampleCount;
+	bool _lazilyAllocated = false;
+
+	VkRenderPass _renderPass = VK_NULL_HANDLE;
+	bool _dynamicRendering;
+
+	VkCommandBufferInheritanceInfo _inheritanceInfo;
+#ifdef VK_KHR_dynamic_rendering
+	VkCommandBufferInheritanceRenderingInfoKHR _inheritanceRenderingInfo;
+#endif
+
+	// Binary, one per frame in flight, only because acquire and present require them
+	std::vector<VkSemaphore> _imageAvailableSemaphores;
+	std::vector<VkSemaphore> _renderFinishedSemaphores;
+	// Graphic timeline value signaled by the last submission of each frame slot and of each image, 0 before the first
+	std::vector<uint64_t> _frameValues;
+	std::vector<uint64_t> _imageValues;
+
+	uint32_t _framesInFlight;
+	uint32_t _currentFrame = 0;
 
+	VkPresentModeKHR _requestedPresentMode;
+	VkPresentModeKHR _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	uint32_t _requestedImageCount;
+
+	// Per frame slot, pending from submission until its timeline value is seen reached
+	std::vector<std::chrono::steady_clock::time_point> _inputTimes;
+	std::vector<bool> _inputMarked;
+	std::vector<bool> _latencyPending;
+	LatencyStats _latencyStats;
+
+	void createSwapchain();
+	void createOffscreenImages();
+	void createImageViews();
+	// Depth and, with MSAA, multisampled color images for the current extent
+	void createAttachments();
+	void createAttachmentImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+		VkImage& image, Allocation& allocation, VkImageView& imageView);
+	void createRenderPass();
+	void createFramebuffers();
+	void createSyncObjects();
+
+	// Transition of the images around dynamic rendering, the render pass does this on its own
+	void transitionImage(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool toAttachment);
+	// Views, framebuffers and attachment images of the current extent
+	void destroyImageResources();
+
+	VkFormat chooseDepthFormat();
+	VkSampleCountFlagBits chooseSampleCount(VkSampleCountFlagBits requestedSampleCount);
+	VkImageAspectFlags getDepthAspect() const;
+
+	VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
+	VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
+	uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const;
+	// Records the latency of a pending slot whose timeline value was reached
+	void collectLatency(uint32_t frameIndex);
+	void collectLatencies();
+};
@@ -0,0 +1,146 @@
+#include "TextureContainer.h"
+
+#include "Alignment.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(TextureContainer::Mip) == 24, "The mip table is read straight from the file");
+
+static const uint64_t PAGE_SIZE = 4096;
+// Satisfies the copy offset alignment of every uncompressed and block-compressed format
+static const uint64_t MIP_ALIGNMENT = 16;
+static const uint32_t MAX_MIP_COUNT = 16;
+
+TextureContainer TextureContainer::open(const std::string& filePath)
+{
+	MappedFile file = MappedFile::map(filePath);
+
+	FileHeader header;
+	if (file.size() < sizeof(header)) {
+		throw std::runtime_error("Texture file is too small: " + filePath);
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (header.magic != MAGIC || header.version != VERSION) {
+		throw std::runtime_error("Texture file has an unknown format or version: " + filePath);
+	}
+	if (header.mipCount == 0 || header.mipCount > MAX_MIP_COUNT || header.width == 0 || header.height == 0) {
+		throw std::runtime_error("Texture file has an invalid header: " + filePath);
+	}
+	if (file.size() < sizeof(header) + sizeof(Mip) * header.mipCount) {
+		throw std::runtime_error("Texture file mip table is truncated: " + filePath);
+	}
+
+	std::vector<Mip> mips(header.mipCount);
+	std::memcpy(mips.data(), static_cast<const char*>(file.data()) + sizeof(header), sizeof(Mip) * header.mipCount);
+
+	VkFormat format = static_cast<VkFormat>(header.format);
+	bool rgba8 = format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+	for (uint32_t level = 0; level < header.mipCount; ++level)
+	{
+		const Mip& mip = mips[level];
+		bool extentValid = mip.width == std::max(1u, header.width >> level) && mip.height == std::max(1u, header.height >> level);
+		bool sizeValid = mip.size > 0 && (!rgba8 || mip.size == static_cast<uint64_t>(mip.width) * mip.height * 4);
+		bool rangeValid = mip.offset % MIP_ALIGNMENT == 0 && mip.offset <= file.size() && mip.size <= file.size() - mip.offset;
+		if (!extentValid || !sizeValid || !rangeValid) {
+			throw std::runtime_error("Texture file has an invalid mip table: " + filePath);
+		}
+	}
+
+	return TextureContainer(std::move(file), format, std::move(mips));
+}
+
+TextureContainer::TextureContainer(MappedFile file, VkFormat format, std::vector<Mip> mips)
+	: _file{ std::move(file) }, _format{ format }, _mips{ std::move(mips) }
+{
+}
+
+void TextureContainer::bake(const std::string& filePath, uint32_t width, uint32_t height, const std::vector<uint32_t>& pixels)
+{
+	if (width == 0 || height == 0 || pixels.size() != static_cast<size_t>(width) * height) {
+		throw std::runtime_error("Texture pixels do not match the extent!");
+	}
+
+	// Every level averages the 2x2 texels below it, odd edges repeat their last texel
+	std::vector<std::vector<uint32_t>> levels(1, pixels);
+	std::vector<Mip> mips(1, Mip{ width, height, 0, 0 });
+	while ((mips.back().width > 1 || mips.back().height > 1) && mips.size() < MAX_MIP_COUNT)
+	{
+		const std::vector<uint32_t>& source = levels.back();
+		uint32_t sourceWidth = mips.back().width;
+		uint32_t sourceHeight = mips.back().height;
+		uint32_t mipWidth = std::max(1u, sourceWidth / 2);
+		uint32_t mipHeight = std::max(1u, sourceHeight / 2);
+
+		std::vector<uint32_t> mip(static_cast<size_t>(mipWidth) * mipHeight);
+		for (uint32_t y = 0; y < mipHeight; ++y)
+		{
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, sourceWidth - 1), x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				uint32_t y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+				const uint32_t texels[4] = { source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1],
+					source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1] };
+
+				uint32_t result = 0;
+				for (uint32_t shift = 0; shift < 32; shift += 8)
+				{
+					uint32_t sum = 2;
+					for (uint32_t texel : texels) {
+						sum += (texel >> shift) & 0xFF;
+					}
+					result |= (sum / 4) << shift;
+				}
+				mip[y * mipWidth + x] = result;
+			}
+		}
+
+		levels.push_back(std::move(mip));
+		mips.push_back(Mip{ mipWidth, mipHeight, 0, 0 });
+	}
+
+	FileHeader header{ MAGIC, VERSION, VK_FORMAT_R8G8B8A8_UNORM, width, height, static_cast<uint32_t>(mips.size()) };
+
+	// Smallest first, so the levels a texture shows first are also the first bytes read
+	uint64_t offset = sizeof(header) + sizeof(Mip) * mips.size();
+	for (size_t level = mips.size(); level-- > 0;)
+	{
+		mips[level].size = static_cast<uint64_t>(mips[level].width) * mips[level].height * 4;
+		offset = alignUp(offset, mips[level].size >= PAGE_SIZE ? PAGE_SIZE : MIP_ALIGNMENT);
+		mips[level].offset = offset;
+		offset += mips[level].size;
+	}
+
+	// Write next to the target first so an interrupted bake never leaves a truncated texture behind
+	std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open texture file for writing: " + filePath);
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mips.data()), sizeof(Mip) * mips.size());
+		uint64_t written = sizeof(header) + sizeof(Mip) * mips.size();
+		for (size_t level = mips.size(); level-- > 0;)
+		{
+			static const char padding[PAGE_SIZE] = {};
+			file.write(padding, static_cast<std::streamsize>(mips[level].offset - written));
+			file.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(mips[level].size));
+			written = mips[level].offset + mips[level].size;
+		}
+		if (!file) {
+			throw std::runtime_error("Failed to write texture file: " + filePath);
+		}
+	}
+
+	std::remove(filePath.c_str());
+	if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+		throw std::runtime_error("Failed to replace texture file: " + filePath);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Memory-mapped texture file baked offline into the form the GPU copies from. A header and mip table are
+// followed by the mip levels, smallest first, each tightly packed as vkCmdCopyBufferToImage reads it with
+// bufferRowLength 0. Mips of a page or more start on a page boundary, so streaming one touches only its own pages
+class TextureContainer
+{
+public:
+	static const uint32_t MAGIC = 0x58455456; // "VTEX"
+	static const uint32_t VERSION = 1;
+
+	struct Mip
+	{
+		uint32_t width;
+		uint32_t height;
+		// From the start of the file
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// Maps the file and validates the header and the mip table against the file size
+	static TextureContainer open(const std::string& filePath);
+	// Writes RGBA8 pixels as R8G8B8A8_UNORM with a box-filtered mip chain down to 1x1
+	static void bake(const std::string& filePath, uint32_t width, uint32_t height, const std::vector<uint32_t>& pixels);
+
+	TextureContainer(TextureContainer&& other) noexcept = default;
+	TextureContainer& operator=(TextureContainer&& other) noexcept = default;
+	TextureContainer(const TextureContainer&) = delete;
+	TextureContainer& operator=(const TextureContainer&) = delete;
+
+	VkFormat getFormat() const { return _format; }
+	uint32_t getWidth() const { return _mips[0].width; }
+	uint32_t getHeight() const { return _mips[0].height; }
+	// Level 0 is the full resolution
+	uint32_t getMipCount() const { return static_cast<uint32_t>(_mips.size()); }
+	const Mip& getMip(uint32_t level) const { return _mips[level]; }
+	const void* getMipData(uint32_t level) const { return static_cast<const char*>(_file.data()) + _mips[level].offset; }
+
+private:
+	// On-disk layout, little endian
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+	};
+
+	TextureContainer(MappedFile file, VkFormat format, std::vector<Mip> mips);
+
+	MappedFile _file;
+	VkFormat _format;
+	std::vector<Mip> _mips;
+};
@@ -0,0 +1,629 @@
+#include "TextureStreamer.h"
+
+#include "Alignment.h"
+#include "StartupTracer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Copy offsets of every uncompressed and block-compressed format are multiples of 16
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+// Requested this recently counts as in use, so a texture drawn every frame is never an eviction candidate
+static const uint64_t IN_USE_FRAMES = 2;
+// Unrequested for longer than this and a texture may be dropped back to its tail
+static const uint64_t EVICT_AFTER_FRAMES = 120;
+// Full resolution loads in flight, more would only split the staging ring into slower streams
+static const uint32_t MAX_UPGRADES = 4;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static VkImageMemoryBarrier imageBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+{
+	VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.srcAccessMask = srcAccessMask;
+	barrier.dstAccessMask = dstAccessMask;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = baseLevel;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.layerCount = 1;
+	return barrier;
+}
+
+TextureStreamer::TextureStreamer(Device& device, BindlessDescriptors& bindless, VkDeviceSize budget, VkDeviceSize stagingSize, uint32_t ioThreadCount)
+	: _device{ device }, _bindless{ bindless }, _budget{ budget }, _stagingSize{ stagingSize }, _ioThreads{ ioThreadCount }
+{
+	StartupTracer::Scope scope("TextureStreamer::TextureStreamer");
+
+	if (_budget == 0)
+	{
+		const VkPhysicalDeviceMemoryProperties& memoryProperties = _device.getAllocator().getMemoryProperties();
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+		{
+			if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+				_budget = std::max(_budget, memoryProperties.memoryHeaps[i].size / 2);
+			}
+		}
+	}
+
+	_device.getAllocator().createBuffer(_stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		_stagingBuffer, _stagingAllocation);
+	if (!_stagingAllocation.mappedData) {
+		throw std::runtime_error("Texture staging memory is not mapped!");
+	}
+
+	VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = _device.getQueueFamilies().transferFamily;
+
+	if (vkCreateCommandPool(_device.getDevice(), &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture streaming command pool!");
+	}
+
+	createPlaceholder();
+	createSampler();
+}
+
+// Expects the GPU to be idle
+TextureStreamer::~TextureStreamer()
+{
+	// IO jobs write into the staging ring and read from the mapped files
+	for (Read& read : _reads) {
+		read.done.wait();
+	}
+	_device.waitTimeline(QueueType::Transfer, _device.getLastTimelineValue(QueueType::Transfer));
+
+	destroyRetiredImages(true);
+
+	MemoryAllocator& allocator = _device.getAllocator();
+	for (std::unique_ptr<Texture>& texture : _textures)
+	{
+		for (Residency* residency : { &texture->current, &texture->previous })
+		{
+			vkDestroyImageView(_device.getDevice(), residency->view, nullptr);
+			if (residency->image != VK_NULL_HANDLE) {
+				allocator.destroyImage(residency->image, residency->allocation);
+			}
+		}
+	}
+
+	vkDestroySampler(_device.getDevice(), _sampler, nullptr);
+	vkDestroyImageView(_device.getDevice(), _placeholderView, nullptr);
+	allocator.destroyImage(_placeholderImage, _placeholderAllocation);
+
+	vkDestroyCommandPool(_device.getDevice(), _commandPool, nullptr);
+	allocator.destroyBuffer(_stagingBuffer, _stagingAllocation);
+}
+
+uint32_t TextureStreamer::addTexture(const std::string& filePath)
+{
+	std::unique_ptr<Texture> texture = std::make_unique<Texture>(TextureContainer::open(filePath));
+	const TextureContainer& container = texture->container;
+
+	for (uint32_t level = 0; level < container.getMipCount(); ++level)
+	{
+		if (container.getMip(level).size > _stagingSize) {
+			throw std::runtime_error("Texture mip does not fit the staging ring: " + filePath);
+		}
+		texture->fullBytes += container.getMip(level).size;
+	}
+
+	texture->tailLevel = container.getMipCount() - 1;
+	while (texture->tailLevel > 0 && std::max(container.getMip(texture->tailLevel - 1).width, container.getMip(texture->tailLevel - 1).height) <= TAIL_SIZE) {
+		--texture->tailLevel;
+	}
+	texture->addTime = std::chrono::steady_clock::now();
+
+	_textures.push_back(std::move(texture));
+	uint32_t index = static_cast<uint32_t>(_textures.size() - 1);
+	startLoad(index, _textures[index]->tailLevel);
+	return index;
+}
+
+void TextureStreamer::update()
+{
+	completeBatches();
+	destroyRetiredImages(false);
+	applyBudget();
+
+	// Tails first, they are small and replace the placeholder
+	issueReads(true);
+	issueReads(false);
+	submitReads();
+
+	++_frame;
+}
+
+uint32_t TextureStreamer::getImageHandle(uint32_t texture) const
+{
+	const Texture& entry = *_textures[texture];
+	if (entry.current.handle != INVALID_HANDLE) {
+		return entry.current.handle;
+	}
+	if (entry.previous.handle != INVALID_HANDLE) {
+		return entry.previous.handle;
+	}
+	return _placeholderHandle;
+}
+
+void TextureStreamer::createPlaceholder()
+{
+	VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = { 1, 1, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	_device.getAllocator().createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _placeholderImage, _placeholderAllocation);
+
+	// Uploaded through the start of the staging ring before any read uses it
+	const uint32_t white = 0xFFFFFFFF;
+	std::memcpy(_stagingAllocation.mappedData, &white, sizeof(white));
+	_device.getAllocator().flush(_stagingAllocation, 0, sizeof(white));
+
+	VkCommandBuffer commandBuffer = _device.beginSingleTimeCommands();
+
+	VkImageMemoryBarrier barrier = imageBarrier(_placeholderImage, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { 1, 1, 1 };
+	vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, _placeholderImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier = imageBarrier(_placeholderImage, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	_device.endSingleTimeCommands(commandBuffer);
+
+	_placeholderView = createView(_placeholderImage, VK_FORMAT_R8G8B8A8_UNORM, 0, 1);
+	_placeholderHandle = _bindless.addImage(_placeholderView);
+}
+
+void TextureStreamer::createSampler()
+{
+	VkSamplerCreateInfo samplerInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	// Views start at the sharpest visible level, so the whole chain below it is always available
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(_device.getDevice(), &samplerInfo, nullptr, &_sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture sampler!");
+	}
+	_samplerHandle = _bindless.addSampler(_sampler);
+}
+
+// The new image replaces current, which stays visible as previous until the new one shows its smallest level
+void TextureStreamer::startLoad(uint32_t texture, uint32_t firstLevel)
+{
+	Texture& entry = *_textures[texture];
+	const TextureContainer& container = entry.container;
+	const TextureContainer::Mip& mip = container.getMip(firstLevel);
+
+	const QueueFamilyIndices& indices = _device.getQueueFamilies();
+	uint32_t queueFamilies[] = { static_cast<uint32_t>(indices.graphicFamily), static_cast<uint32_t>(indices.transferFamily) };
+
+	VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = container.getFormat();
+	imageInfo.extent = { mip.width, mip.height, 1 };
+	imageInfo.mipLevels = container.getMipCount() - firstLevel;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	// Written on the transfer queue and sampled on the graphic queue, concurrent sharing saves an ownership transfer per level
+	if (queueFamilies[0] != queueFamilies[1])
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = 2;
+		imageInfo.pQueueFamilyIndices = queueFamilies;
+	}
+	else
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	Residency residency;
+	residency.firstLevel = firstLevel;
+	residency.visibleLevel = container.getMipCount();
+	_device.getAllocator().createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, residency.image, residency.allocation);
+	trackResidentBytes(residency.allocation.size, 0);
+
+	entry.previous = entry.current;
+	entry.current = residency;
+	entry.loading = true;
+	entry.unreadLevels = imageInfo.mipLevels;
+	entry.loadStartTime = std::chrono::steady_clock::now();
+}
+
+// Upgrades requested textures while the images fit the budget. When one does not, textures unused for a
+// while are dropped to their tails first. Their memory returns only once the tails are visible and the GPU
+// is done with the large images, so the upgrade is retried on a later frame
+void TextureStreamer::applyBudget()
+{
+	uint32_t upgrades = 0;
+	for (const std::unique_ptr<Texture>& texture : _textures)
+	{
+		if (texture->loading && texture->current.firstLevel < texture->tailLevel) {
+			++upgrades;
+		}
+	}
+
+	for (uint32_t index = 0; index < _textures.size() && upgrades < MAX_UPGRADES; ++index)
+	{
+		Texture& texture = *_textures[index];
+		bool inUse = _frame - texture.lastRequestFrame.load(std::memory_order_relaxed) <= IN_USE_FRAMES;
+		if (!inUse || texture.loading || texture.current.firstLevel == 0 || texture.fullBytes > _budget) {
+			continue;
+		}
+
+		// Memory already on its way out counts as free
+		VkDeviceSize committedBytes = _stats.residentBytes - _evictingBytes;
+		if (committedBytes + texture.fullBytes <= _budget)
+		{
+			startLoad(index, 0);
+			++upgrades;
+			continue;
+		}
+
+		std::vector<uint32_t> candidates;
+		for (uint32_t other = 0; other < _textures.size(); ++other)
+		{
+			const Texture& candidate = *_textures[other];
+			if (!candidate.loading && candidate.current.firstLevel < candidate.tailLevel &&
+				_frame - candidate.lastRequestFrame.load(std::memory_order_relaxed) > EVICT_AFTER_FRAMES) {
+				candidates.push_back(other);
+			}
+		}
+		// Least recently requested first
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+			return _textures[a]->lastRequestFrame.load(std::memory_order_relaxed) < _textures[b]->lastRequestFrame.load(std::memory_order_relaxed);
+		});
+
+		for (uint32_t candidate : candidates)
+		{
+			if (committedBytes + texture.fullBytes <= _budget) {
+				break;
+			}
+
+			Texture& evicted = *_textures[candidate];
+			VkDeviceSize evictedBytes = evicted.current.allocation.size;
+			startLoad(candidate, evicted.tailLevel);
+			evicted.evicting = true;
+			_evictingBytes += evictedBytes;
+			committedBytes -= evictedBytes;
+			++_stats.evictions;
+		}
+		// Nothing more can go without evicting textures in use, the remaining ones wait for a later frame
+		break;
+	}
+}
+
+void TextureStreamer::issueReads(bool tails)
+{
+	for (uint32_t index = 0; index < _textures.size(); ++index)
+	{
+		Texture& texture = *_textures[index];
+		if (!texture.loading || (texture.current.firstLevel == texture.tailLevel) != tails) {
+			continue;
+		}
+
+		while (texture.unreadLevels > 0)
+		{
+			uint32_t level = texture.current.firstLevel + texture.unreadLevels - 1;
+			VkDeviceSize size = texture.container.getMip(level).size;
+
+			// The ring is consumed in order, so once it is full no later read fits either
+			VkDeviceSize stagingOffset;
+			if (!allocateStaging(size, stagingOffset)) {
+				return;
+			}
+
+			// Pages of the mapped file are read in by the IO thread touching them, never by the frame loop
+			const void* source = texture.container.getMipData(level);
+			void* destination = static_cast<char*>(_stagingAllocation.mappedData) + stagingOffset;
+			Read read{ index, level, stagingOffset, size,
+				_ioThreads.submit([source, destination, size]() { std::memcpy(destination, source, static_cast<size_t>(size)); }) };
+			_reads.push_back(std::move(read));
+
+			--texture.unreadLevels;
+		}
+	}
+}
+
+// Copies every read the IO threads have finished, in staging order, with one submission on the transfer queue
+void TextureStreamer::submitReads()
+{
+	size_t readyCount = 0;
+	while (readyCount < _reads.size() && _reads[readyCount].done.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		++readyCount;
+	}
+	if (readyCount == 0) {
+		return;
+	}
+
+	Batch batch;
+	batch.readCount = readyCount;
+
+	if (!_freeCommandBuffers.empty())
+	{
+		batch.commandBuffer = _freeCommandBuffers.back();
+		_freeCommandBuffers.pop_back();
+		vkResetCommandBuffer(batch.commandBuffer, 0);
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		allocateInfo.commandPool = _commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(_device.getDevice(), &allocateInfo, &batch.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate texture streaming command buffer!");
+		}
+	}
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording texture streaming command buffer!");
+	}
+
+	std::vector<VkImageMemoryBarrier> copyBarriers;
+	std::vector<VkImageMemoryBarrier> readBarriers;
+	for (size_t i = 0; i < readyCount; ++i)
+	{
+		Read& read = _reads[i];
+		// Rethrows what failed on the IO thread
+		read.done.get();
+		_device.getAllocator().flush(_stagingAllocation, read.stagingOffset, read.size);
+
+		const Residency& residency = _textures[read.texture]->current;
+		uint32_t levelCount = _textures[read.texture]->container.getMipCount() - residency.firstLevel;
+		// The smallest level is always read first, the whole image leaves UNDEFINED with it
+		if (read.level == residency.firstLevel + levelCount - 1)
+		{
+			copyBarriers.push_back(imageBarrier(residency.image, 0, levelCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				0, VK_ACCESS_TRANSFER_WRITE_BIT));
+		}
+		readBarriers.push_back(imageBarrier(residency.image, read.level - residency.firstLevel, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+	}
+
+	if (!copyBarriers.empty())
+	{
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(copyBarriers.size()), copyBarriers.data());
+	}
+
+	for (size_t i = 0; i < readyCount; ++i)
+	{
+		const Read& read = _reads[i];
+		const Texture& texture = *_textures[read.texture];
+		const TextureContainer::Mip& mip = texture.container.getMip(read.level);
+
+		// Mips are tightly packed, so bufferRowLength and bufferImageHeight stay 0
+		VkBufferImageCopy region{};
+		region.bufferOffset = read.stagingOffset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = read.level - texture.current.firstLevel;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { mip.width, mip.height, 1 };
+		vkCmdCopyBufferToImage(batch.commandBuffer, _stagingBuffer, texture.current.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		batch.levels.emplace_back(read.texture, read.level);
+		_stats.uploadedBytes += read.size;
+		++_stats.uploadedMips;
+	}
+
+	// The graphic queue waits for the transfer timeline before sampling, which makes the copies visible to it
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(readBarriers.size()), readBarriers.data());
+
+	if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record texture streaming command buffer!");
+	}
+
+	VkSemaphore timeline = _device.getTimeline(QueueType::Transfer);
+	batch.transferValue = _device.nextTimelineValue(QueueType::Transfer);
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &batch.transferValue;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline;
+
+	if (vkQueueSubmit(_device.getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit texture streaming command buffer!");
+	}
+
+	_reads.erase(_reads.begin(), _reads.begin() + readyCount);
+	_batches.push_back(std::move(batch));
+}
+
+void TextureStreamer::completeBatches()
+{
+	std::vector<uint32_t> completedTextures;
+	while (!_batches.empty() && _device.isTimelineReached(QueueType::Transfer, _batches.front().transferValue))
+	{
+		Batch& batch = _batches.front();
+		for (const std::pair<uint32_t, uint32_t>& level : batch.levels)
+		{
+			Residency& residency = _textures[level.first]->current;
+			residency.visibleLevel = std::min(residency.visibleLevel, level.second);
+			completedTextures.push_back(level.first);
+		}
+
+		_stagingRanges.erase(_stagingRanges.begin(), _stagingRanges.begin() + batch.readCount);
+		_publishedValue = batch.transferValue;
+		_freeCommandBuffers.push_back(batch.commandBuffer);
+		_batches.pop_front();
+	}
+
+	std::sort(completedTextures.begin(), completedTextures.end());
+	completedTextures.erase(std::unique(completedTextures.begin(), completedTextures.end()), completedTextures.end());
+	for (uint32_t texture : completedTextures) {
+		publish(texture);
+	}
+}
+
+// Views are immutable, so every refinement gets a new view and handle. Frames in flight keep sampling the old ones
+void TextureStreamer::publish(uint32_t texture)
+{
+	Texture& entry = *_textures[texture];
+	Residency& current = entry.current;
+	uint32_t mipCount = entry.container.getMipCount();
+
+	VkImageView view = createView(current.image, entry.container.getFormat(), current.visibleLevel - current.firstLevel, mipCount - current.visibleLevel);
+	uint32_t handle = _bindless.addImage(view);
+
+	if (current.handle != INVALID_HANDLE)
+	{
+		_bindless.release(BindlessDescriptors::ResourceType::Image, current.handle);
+		_retiredImages.push_back(RetiredImage{ VK_NULL_HANDLE, Allocation{}, current.view, _device.getLastTimelineValue(QueueType::Graphic), 0 });
+	}
+	current.view = view;
+	current.handle = handle;
+
+	if (entry.previous.image != VK_NULL_HANDLE)
+	{
+		retire(entry.previous, entry.evicting ? entry.previous.allocation.size : 0);
+		entry.evicting = false;
+	}
+
+	if (!entry.firstMipVisible)
+	{
+		entry.firstMipVisible = true;
+		double milliseconds = millisecondsSince(entry.addTime);
+		++_stats.firstMipCount;
+		_stats.firstMipMilliseconds += milliseconds;
+		_stats.maxFirstMipMilliseconds = std::max(_stats.maxFirstMipMilliseconds, milliseconds);
+	}
+
+	if (current.visibleLevel == current.firstLevel)
+	{
+		entry.loading = false;
+		if (current.firstLevel == 0 && entry.tailLevel > 0)
+		{
+			double milliseconds = millisecondsSince(entry.loadStartTime);
+			++_stats.fullResolutionCount;
+			_stats.fullResolutionMilliseconds += milliseconds;
+			_stats.maxFullResolutionMilliseconds = std::max(_stats.maxFullResolutionMilliseconds, milliseconds);
+		}
+	}
+}
+
+// Frames already submitted may still sample the residency, so it is destroyed once the graphic queue has finished them
+void TextureStreamer::retire(Residency& residency, VkDeviceSize evictedBytes)
+{
+	if (residency.handle != INVALID_HANDLE) {
+		_bindless.release(BindlessDescriptors::ResourceType::Image, residency.handle);
+	}
+	_retiredImages.push_back(RetiredImage{ residency.image, residency.allocation, residency.view, _device.getLastTimelineValue(QueueType::Graphic),
+		evictedBytes });
+	residency = Residency{};
+}
+
+void TextureStreamer::destroyRetiredImages(bool all)
+{
+	while (!_retiredImages.empty() && (all || _device.isTimelineReached(QueueType::Graphic, _retiredImages.front().graphicValue)))
+	{
+		RetiredImage& retired = _retiredImages.front();
+		vkDestroyImageView(_device.getDevice(), retired.view, nullptr);
+		if (retired.image != VK_NULL_HANDLE)
+		{
+			trackResidentBytes(0, retired.allocation.size);
+			_device.getAllocator().destroyImage(retired.image, retired.allocation);
+		}
+		_evictingBytes -= retired.evictedBytes;
+		_retiredImages.pop_front();
+	}
+}
+
+bool TextureStreamer::allocateStaging(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (_stagingRanges.empty())
+	{
+		offset = 0;
+	}
+	else
+	{
+		VkDeviceSize tail = _stagingRanges.front().first;
+		VkDeviceSize end = tail;
+		offset = alignUp(_stagingHead, STAGING_ALIGNMENT);
+
+		// Ranges are never empty, so the head is at or below the tail only after wrapping around
+		if (_stagingHead > tail)
+		{
+			end = _stagingSize;
+			if (offset + size > end)
+			{
+				offset = 0;
+				end = tail;
+			}
+		}
+		if (offset + size > end) {
+			return false;
+		}
+	}
+
+	_stagingRanges.emplace_back(offset, offset + size);
+	_stagingHead = offset + size;
+	return true;
+}
+
+VkImageView TextureStreamer::createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount)
+{
+	VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = baseLevel;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	VkImageView view;
+	if (vkCreateImageView(_device.getDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture image view!");
+	}
+	return view;
+}
+
+void TextureStreamer::trackResidentBytes(VkDeviceSize allocatedBytes, VkDeviceSize freedBytes)
+{
+	_stats.residentBytes = _stats.residentBytes + allocatedBytes - freedBytes;
+	_stats.peakResidentBytes = std::max(_stats.peakResidentBytes, _stats.residentBytes);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "BindlessDescriptors.h"
+#include "Device.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Streams texture containers into sampled images on the transfer queue. IO threads copy mips from the mapped
+// files into a staging ring, smallest level first, and every completed level becomes visible at once through a
+// new bindless handle, so textures sharpen as they arrive. Each texture keeps a small mip tail resident, requested
+// textures are raised to full resolution while the budget allows, and textures not requested for a while are
+// dropped back to their tail when a requested one needs the room
+class TextureStreamer
+{
+public:
+	// Mips up to this size form the tail, which stays resident for every texture
+	static const uint32_t TAIL_SIZE = 64;
+	static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+	struct Stats
+	{
+		uint64_t uploadedBytes = 0;
+		uint32_t uploadedMips = 0;
+		uint32_t evictions = 0;
+		// From adding the texture until its first mip is visible
+		uint32_t firstMipCount = 0;
+		double firstMipMilliseconds = 0.0;
+		double maxFirstMipMilliseconds = 0.0;
+		// From starting the upgrade until the full resolution is visible
+		uint32_t fullResolutionCount = 0;
+		double fullResolutionMilliseconds = 0.0;
+		double maxFullResolutionMilliseconds = 0.0;
+		// Texture images, including the ones waiting for the GPU to let go of them
+		VkDeviceSize residentBytes = 0;
+		VkDeviceSize peakResidentBytes = 0;
+	};
+
+	// A budget of 0 uses half of the largest device-local heap
+	TextureStreamer(Device& device, BindlessDescriptors& bindless, VkDeviceSize budget = 0, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE,
+		uint32_t ioThreadCount = 2);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Opens the container and starts streaming its tail. Returns the index passed to request and getImageHandle
+	uint32_t addTexture(const std::string& filePath);
+
+	// Marks the texture as used this frame. Thread safe, may be called while recording on any thread
+	void request(uint32_t texture) { _textures[texture]->lastRequestFrame.store(_frame, std::memory_order_relaxed); }
+
+	// Once per frame on the thread submitting to the graphic queue, before recording. Publishes the mips the
+	// transfer queue has finished, frees what the GPU no longer uses, applies the budget and submits new copies
+	void update();
+
+	// Bindless image handle of the sharpest mips visible so far, a white placeholder until the first one arrives
+	uint32_t getImageHandle(uint32_t texture) const;
+	uint32_t getSamplerHandle() const { return _samplerHandle; }
+	// Transfer timeline value the graphic submission has to wait for at the fragment shader stage.
+	// It has already been reached, the wait only makes the uploads visible to the graphic queue
+	uint64_t getPublishedValue() const { return _publishedValue; }
+
+	uint32_t getTextureCount() const { return static_cast<uint32_t>(_textures.size()); }
+	VkDeviceSize getBudget() const { return _budget; }
+	const Stats& getStats() const { return _stats; }
+
+private:
+	static const uint32_t INVALID_HANDLE = ~0u;
+
+	// An image holding the container levels from firstLevel down to the smallest one
+	struct Residency
+	{
+		VkImage image = VK_NULL_HANDLE;
+		Allocation allocation;
+		VkImageView view = VK_NULL_HANDLE;
+		uint32_t handle = INVALID_HANDLE;
+		uint32_t firstLevel = 0;
+		// Sharpest level uploaded and covered by view, the container's mip count before the first one
+		uint32_t visibleLevel = 0;
+	};
+
+	struct Texture
+	{
+		explicit Texture(TextureContainer textureContainer) : container{ std::move(textureContainer) } {}
+
+		TextureContainer container;
+		uint32_t tailLevel = 0;
+		// Bytes of all levels, what raising the texture to full resolution costs
+		VkDeviceSize fullBytes = 0;
+
+		Residency current;
+		// Kept visible until current shows its first level
+		Residency previous;
+
+		// Until every level of current is visible
+		bool loading = false;
+		// previous is the larger image being evicted
+		bool evicting = false;
+		// Levels of current still to be read into staging, smallest first
+		uint32_t unreadLevels = 0;
+
+		std::atomic<uint64_t> lastRequestFrame{ 0 };
+		std::chrono::steady_clock::time_point addTime;
+		std::chrono::steady_clock::time_point loadStartTime;
+		bool firstMipVisible = false;
+	};
+
+	// A mip an IO thread copies into the staging ring
+	struct Read
+	{
+		uint32_t texture;
+		uint32_t level;
+		VkDeviceSize stagingOffset;
+		VkDeviceSize size;
+		std::future<void> done;
+	};
+
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer;
+		uint64_t transferValue;
+		// Oldest staging ranges, freed once the batch has finished
+		size_t readCount;
+		// Texture and level of every copy
+		std::vector<std::pair<uint32_t, uint32_t>> levels;
+	};
+
+	// Destroyed once the graphic queue has finished every frame submitted before it was retired
+	struct RetiredImage
+	{
+		VkImage image;
+		Allocation allocation;
+		VkImageView view;
+		uint64_t graphicValue;
+		// Part of _evictingBytes until destroyed
+		VkDeviceSize evictedBytes;
+	};
+
+	Device& _device;
+	BindlessDescriptors& _bindless;
+	VkDeviceSize _budget;
+	// Only changes in update, between the frames' recordings
+	uint64_t _frame = 1;
+
+	std::vector<std::unique_ptr<Texture>> _textures;
+
+	VkBuffer _stagingBuffer;
+	Allocation _stagingAllocation;
+	VkDeviceSize _stagingSize;
+	VkDeviceSize _stagingHead = 0;
+	// Ranges in use, oldest first. A read's range is freed with the batch that copies it
+	std::deque<std::pair<VkDeviceSize, VkDeviceSize>> _stagingRanges;
+
+	ThreadPool _ioThreads;
+	// In staging order, copied in the same order
+	std::deque<Read> _reads;
+
+	VkCommandPool _commandPool;
+	std::deque<Batch> _batches;
+	std::vector<VkCommandBuffer> _freeCommandBuffers;
+	uint64_t _publishedValue = 0;
+
+	std::deque<RetiredImage> _retiredImages;
+	VkDeviceSize _evictingBytes = 0;
+
+	VkImage _placeholderImage;
+	Allocation _placeholderAllocation;
+	VkImageView _placeholderView;
+	uint32_t _placeholderHandle;
+	VkSampler _sampler;
+	uint32_t _samplerHandle;
+
+	Stats _stats;
+
+	void createPlaceholder();
+	void createSampler();
+
+	void startLoad(uint32_t texture, uint32_t firstLevel);
+	void applyBudget();
+	void issueReads(bool tails);
+	void submitReads();
+	void completeBatches();
+	void publish(uint32_t texture);
+	void retire(Residency& residency, VkDeviceSize evictedBytes);
+	void destroyRetiredImages(bool all);
+
+	// Offset of size free bytes, false when the ring has no room for them yet
+	bool allocateStaging(VkDeviceSize size, VkDeviceSize& offset);
+	VkImageView createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount);
+	void trackResidentBytes(VkDeviceSize allocatedBytes, VkDeviceSize freedBytes);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one shared queue
+class ThreadPool
+{
+public:
+	// Zero picks one thread per hardware core
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename Task>
+	auto submit(Task&& task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+		std::future<Result> future = packagedTask->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.emplace([packagedTask]() { (*packagedTask)(); });
+		}
+		_condition.notify_one();
+
+		return future;
+	}
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+private:
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping = false;
+
+	void workerLoop();
+};
@@ -0,0 +1,135 @@
+#include "UniformRing.h"
+
+#include "Alignment.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+UniformRing::UniformRing(Device& device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame, VkDeviceSize maxBlockSize, VkShaderStageFlags stages,
+	VkDeviceSize persistentBytes)
+	: _device{ device }
+{
+	VkPhysicalDeviceLimits limits = _device.getProperties().limits;
+	_alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+	_bytesPerFrame = alignUp(bytesPerFrame, _alignment);
+	_maxBlockSize = maxBlockSize;
+	_persistentBytes = alignUp(persistentBytes, _alignment);
+
+	if (_maxBlockSize == 0 || _maxBlockSize > limits.maxUniformBufferRange) {
+		throw std::runtime_error("Uniform ring block size exceeds maxUniformBufferRange!");
+	}
+
+	// The descriptor range reaches maxBlockSize past every offset, including the last one of the last region
+	VkDeviceSize size = _persistentBytes + _bytesPerFrame * framesInFlight + _maxBlockSize;
+	_device.getAllocator().createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _buffer, _allocation);
+
+	if (!_allocation.mappedData) {
+		throw std::runtime_error("Uniform ring memory is not mapped!");
+	}
+
+	_persistentRegion.reset(0, _persistentBytes);
+	_frameRegion.reset(_persistentBytes, _bytesPerFrame);
+
+	createDescriptorSet(stages);
+}
+
+UniformRing::~UniformRing()
+{
+	vkDestroyDescriptorPool(_device.getDevice(), _descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(_device.getDevice(), _descriptorSetLayout, nullptr);
+	_device.getAllocator().destroyBuffer(_buffer, _allocation);
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex)
+{
+	_frameRegion.reset(_persistentBytes + _bytesPerFrame * frameIndex, _bytesPerFrame);
+}
+
+void* UniformRing::allocate(VkDeviceSize size, uint32_t& dynamicOffset)
+{
+	return suballocate(size, _frameRegion, dynamicOffset);
+}
+
+void* UniformRing::allocatePersistent(VkDeviceSize size, uint32_t& dynamicOffset)
+{
+	return suballocate(size, _persistentRegion, dynamicOffset);
+}
+
+void* UniformRing::suballocate(VkDeviceSize size, RingRegion& region, uint32_t& dynamicOffset)
+{
+	if (size > _maxBlockSize) {
+		throw std::runtime_error("Uniform block is larger than the descriptor range!");
+	}
+
+	VkDeviceSize blockOffset;
+	if (!region.allocate(size, _alignment, blockOffset)) {
+		throw std::runtime_error("Uniform ring region is full!");
+	}
+
+	dynamicOffset = static_cast<uint32_t>(blockOffset);
+	return static_cast<char*>(_allocation.mappedData) + blockOffset;
+}
+
+void UniformRing::flush()
+{
+	_persistentRegion.flush(_device.getAllocator(), _allocation);
+	_frameRegion.flush(_device.getAllocator(), _allocation);
+}
+
+void UniformRing::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t dynamicOffset)
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &_descriptorSet, 1, &dynamicOffset);
+}
+
+void UniformRing::createDescriptorSet(VkShaderStageFlags stages)
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = stages;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(_device.getDevice(), &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(_device.getDevice(), &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocateInfo.descriptorPool = _descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &_descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(_device.getDevice(), &allocateInfo, &_descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate uniform ring descriptor set!");
+	}
+
+	// The only descriptor write, every block is reached through the dynamic offset
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = _buffer;
+	bufferInfo.range = _maxBlockSize;
+
+	VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	write.dstSet = _descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(_device.getDevice(), 1, &write, 0, nullptr);
+}
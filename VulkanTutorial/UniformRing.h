@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Device.h"
+#include "RingRegion.h"
+
+// Persistently mapped uniform buffer behind a single dynamic uniform descriptor. Each frame in flight
+// sub-allocates its own region linearly and binds the results by dynamic offset, so per-frame and
+// per-object constants need no mapping, allocation or descriptor write after construction
+class UniformRing
+{
+public:
+	// maxBlockSize is the descriptor range, the largest block a shader may read at one offset.
+	// persistentBytes are kept apart for blocks written once, e.g. by command buffers that are replayed
+	UniformRing(Device& device, uint32_t framesInFlight, VkDeviceSize bytesPerFrame, VkDeviceSize maxBlockSize, VkShaderStageFlags stages,
+		VkDeviceSize persistentBytes = 0);
+	~UniformRing();
+
+	UniformRing(const UniformRing&) = delete;
+	UniformRing& operator=(const UniformRing&) = delete;
+
+	// Starts handing out blocks from the frame slot's region. Dynamic offsets bound by the slot's previous
+	// frame become invalid, so only call this once that frame has finished executing
+	void beginFrame(uint32_t frameIndex);
+
+	// Returns where to write size bytes and the dynamic offset to bind them with. Throws when the frame region is full
+	void* allocate(VkDeviceSize size, uint32_t& dynamicOffset);
+	template<typename T>
+	T* allocate(uint32_t& dynamicOffset) { return static_cast<T*>(allocate(sizeof(T), dynamicOffset)); }
+	// Same from the persistent region, which is never rewound
+	void* allocatePersistent(VkDeviceSize size, uint32_t& dynamicOffset);
+
+	// Makes everything written since the last flush visible to the device, call before submitting
+	void flush();
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const { return _descriptorSetLayout; }
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t dynamicOffset);
+
+	VkDeviceSize getBytesPerFrame() const { return _bytesPerFrame; }
+
+private:
+	Device& _device;
+	VkDeviceSize _alignment;
+	VkDeviceSize _bytesPerFrame;
+	VkDeviceSize _maxBlockSize;
+	VkDeviceSize _persistentBytes;
+
+	// Persistent region first, then one region per frame in flight
+	VkBuffer _buffer;
+	Allocation _allocation;
+
+	RingRegion _persistentRegion;
+	RingRegion _frameRegion;
+
+	VkDescriptorSetLayout _descriptorSetLayout;
+	VkDescriptorPool _descriptorPool;
+	VkDescriptorSet _descriptorSet;
+
+	void createDescriptorSet(VkShaderStageFlags stages);
+	void* suballocate(VkDeviceSize size, RingRegion& region, uint32_t& dynamicOffset);
+};
@@ -5,9 +5,15 @@ Window::Window(int width, int height, std::string name) : _width{ width }, _heig
 	glfwInit();
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	_pWindow = glfwCreateWindow(width, height, name.c_str(), nullptr, nullptr);
+
+	// On high-DPI displays the framebuffer is larger than the requested window size
+	glfwGetFramebufferSize(_pWindow, &_width, &_height);
+
+	glfwSetWindowUserPointer(_pWindow, this);
+	glfwSetFramebufferSizeCallback(_pWindow, framebufferResizeCallback);
 }
 
 Window::~Window()
@@ -25,3 +31,11 @@ bool Window::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface)
 	}
 	return true;
 }
+
+void Window::framebufferResizeCallback(GLFWwindow* pWindow, int width, int height)
+{
+	Window* window = static_cast<Window*>(glfwGetWindowUserPointer(pWindow));
+	window->_width = width;
+	window->_height = height;
+	window->_framebufferResized = true;
+}
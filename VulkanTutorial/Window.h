@@ -1,6 +1,8 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -13,12 +15,20 @@ public:
 	Window(int width, int height, std::string name);
 	~Window();
 
+	Window(const Window&) = delete;
+	Window& operator=(const Window&) = delete;
+
 	bool createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
-	bool shouldClose() { return !glfwWindowShouldClose(_pWindow); }
+	bool shouldClose() { return glfwWindowShouldClose(_pWindow); }
 
+	// Framebuffer size in pixels, zero while minimized
 	int getWidth() const { return _width; }
 	int getHeight() const { return _height; }
+	VkExtent2D getExtent() const { return { static_cast<uint32_t>(_width), static_cast<uint32_t>(_height) }; }
+
+	bool wasResized() const { return _framebufferResized; }
+	void resetResizedFlag() { _framebufferResized = false; }
 
 	GLFWwindow* getWindow() const { return _pWindow; }
 
@@ -27,7 +37,10 @@ private:
 
 	int _width;
 	int _height;
+	bool _framebufferResized = false;
 	
 	std::string _windowName;
+
+	static void framebufferResizeCallback(GLFWwindow* pWindow, int width, int height);
 };
 
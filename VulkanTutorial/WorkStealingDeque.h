@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Fixed capacity Chase-Lev deque of pointers. The owning thread pushes and pops at the bottom without locks,
+// any other thread may steal from the top, competing with the owner only for the last element
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	// Capacity is rounded up to a power of two
+	explicit WorkStealingDeque(uint32_t capacity)
+	{
+		uint32_t roundedCapacity = 1;
+		while (roundedCapacity < capacity) {
+			roundedCapacity <<= 1;
+		}
+
+		_mask = roundedCapacity - 1;
+		_buffer.reset(new std::atomic<T*>[roundedCapacity]);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// Owner only. False when the deque is full
+	bool push(T* item)
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed);
+		int64_t top = _top.load(std::memory_order_acquire);
+		if (bottom - top > static_cast<int64_t>(_mask)) {
+			return false;
+		}
+
+		_buffer[bottom & _mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only, newest item first. nullptr when empty or a thief took the last item
+	T* pop()
+	{
+		int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = _top.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = _buffer[bottom & _mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last item, whoever moves top first gets it
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				item = nullptr;
+			}
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread, oldest item first. nullptr when empty or another thread won the race
+	T* steal()
+	{
+		int64_t top = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom) {
+			return nullptr;
+		}
+
+		T* item = _buffer[top & _mask].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return item;
+	}
+
+	// Only a hint while other threads are pushing or stealing
+	bool empty() const
+	{
+		return _top.load(std::memory_order_relaxed) >= _bottom.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Apart so thieves hammering top do not invalidate the owner's cache line
+	alignas(64) std::atomic<int64_t> _top{ 0 };
+	alignas(64) std::atomic<int64_t> _bottom{ 0 };
+	std::unique_ptr<std::atomic<T*>[]> _buffer;
+	uint32_t _mask;
+};
@@ -1,493 +1,1311 @@
-#define VK_USE_PLATFORM_WIN32_KHR
-
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
+#include "BindlessDescriptors.h"
+#include "CommandBufferCache.h"
+#include "CullingBenchmark.h"
+#include "GpuCuller.h"
+#include "JobSystem.h"
+#include "JobSystemBenchmark.h"
+#include "Model.h"
+#include "ParallelCommandRecorder.h"
+#include "Pipeline.h"
+#include "PipelineCache.h"
+#include "PipelineStatistics.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "StagingRing.h"
+#include "StartupTracer.h"
+#include "SwapChain.h"
+#include "TextureContainer.h"
+#include "TextureStreamer.h"
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <future>
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
-const std::vector<const char*> validationLayers = {
-	"VK_LAYER_KHRONOS_validation"
-};
+const uint32_t WIDTH = 640 * 2;
+const uint32_t HEIGHT = 480 * 2;
+// Instances a job of the CPU animation spins
+const uint32_t ANIMATE_BATCH_SIZE = 4096;
+// Uniform ring region of a frame, the frame constants plus room for per-object blocks
+const VkDeviceSize UNIFORM_BYTES_PER_FRAME = 4096;
+// Extent of the baked procedural textures, 1024 gives a 5.3 MiB mip chain above a 64x64 tail
+const uint32_t TEXTURE_SIZE = 1024;
+
+static const char* presentModeName(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+	default: return "unknown";
+	}
+}
+
+static VkPresentModeKHR parsePresentMode(const std::string& name)
+{
+	const VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+		VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
 
-#ifdef NDEBUG
-const bool enableValidationLayers = false;
-#else
-const bool enableValidationLayers = true;
-#endif
+	for (VkPresentModeKHR presentMode : presentModes)
+	{
+		if (name == presentModeName(presentMode))
+			return presentMode;
+	}
 
-const std::vector<const char*> instanceExtensions = {
-	VK_KHR_SURFACE_EXTENSION_NAME,
-	VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-};
+	throw std::runtime_error("Unknown present mode: " + name);
+}
 
-const std::vector<const char*> deviceExtensions = {
-	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+struct AppSettings
+{
+	uint32_t framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	// 0 lets the swapchain pick one above the surface minimum
+	uint32_t swapchainImages = 0;
+	// Render with VK_KHR_dynamic_rendering instead of a render pass when the device supports it
+	bool dynamicRendering = false;
+	// MSAA sample count, lowered to what the device supports
+	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	// Sample input and record only once the previous frame has left the GPU
+	bool lowLatency = false;
+	// Render into offscreen images without creating a window or surface
+	bool headless = false;
+	// Stop after this many frames, 0 runs until the window is closed
+	uint64_t frameCount = 0;
+	// Empty path disables the on-disk pipeline cache
+	std::string pipelineCachePath = "pipeline_cache.bin";
+	// Pipeline compile threads, 0 uses one per core
+	uint32_t pipelineThreads = 0;
+	// Pre-record one command buffer per swapchain image and replay it until invalidated
+	bool staticScene = false;
+	// Profiling is enabled when either output is requested
+	std::string profileReportPath;
+	std::string profileTracePath;
+	// Triangles per depth layer, drawn by one instanced draw. Combine with --headless --frames for a benchmark not capped by vsync
+	uint32_t instanceCount = 1;
+	// The instances are split evenly into this many draws to simulate scenes with many objects
+	uint32_t drawCount = 1;
+	// Secondary command buffers the render pass is split into and recorded by parallel jobs, 0 records inline
+	uint32_t recordThreads = 0;
+	// Job system threads running the per-frame CPU work, the main thread included. 0 uses one per core
+	uint32_t jobThreads = 0;
+	// Run the job system micro-benchmarks instead of rendering
+	bool jobBenchmark = false;
+	// Run the CPU culling benchmark instead of rendering
+	bool cullBenchmark = false;
+	// Cull the draws in a compute pass and draw the survivors with vkCmdDrawIndirectCount
+	bool gpuCulling = false;
+	// Cull the draws on the CPU with SIMD and record only the visible ones
+	bool cpuCulling = false;
+	// Run the culling on the dedicated compute queue, overlapping the previous frame's rendering
+	bool asyncCompute = false;
+	// Spin every instance on the CPU and stream the instance buffer each frame
+	bool animate = false;
+	// Zooms into the center of the scene, values above 1 push most draws off screen
+	float zoom = 1.0f;
+	// Copies of the instance grid stacked at increasing depth, generated back to front as the worst case for depth testing
+	uint32_t depthLayers = 1;
+	// Sort the instances, and with them the draws, front to back so early depth tests reject hidden fragments
+	bool frontToBack = false;
+	// Lay down the depth in a depth-only pass first, then shade only the visible fragments with an EQUAL depth test
+	bool depthPrepass = false;
+	// Count shader invocations with pipeline statistics queries and report the overdraw
+	bool overdrawStats = false;
+	// Bind one global descriptor set per command buffer and let the vertex shader pull the instances through a bindless handle
+	bool bindless = false;
+	// Procedural textures streamed from baked containers, one per draw in turn. Sampling needs --bindless
+	uint32_t textureCount = 0;
+	// Device memory the streamed textures may use in MiB, 0 uses half of the largest device-local heap
+	uint32_t textureBudgetMegabytes = 0;
+	// Time the startup phases and driver calls, printing a summary. A non-empty path also writes the timeline
+	bool traceStartup = false;
+	std::string startupTracePath;
+	// Startup scopes slower than this are flagged in the summary
+	double startupThresholdMilliseconds = 10.0;
 };
 
-const uint32_t WIDTH = 640 * 2;
-const uint32_t HEIGHT = 480 * 2;
-
 class HelloTriangleApplication
 {
 public:
+	HelloTriangleApplication(const AppSettings& settings) : settings{ settings } {}
+
 	void run()
 	{
-		initWindow();
-		initVulkan();
+		std::unique_ptr<StartupTracer> startupTracer;
+		if (settings.traceStartup)
+		{
+			startupTracer = std::make_unique<StartupTracer>(settings.startupThresholdMilliseconds);
+			StartupTracer::setActive(startupTracer.get());
+		}
+
+		{
+			StartupTracer::Scope scope("initWindow");
+			initWindow();
+		}
+		{
+			StartupTracer::Scope scope("initVulkan");
+			initVulkan();
+		}
+
+		if (startupTracer)
+		{
+			StartupTracer::setActive(nullptr);
+			startupTracer->printSummary(std::cout);
+			if (!settings.startupTracePath.empty())
+				startupTracer->writeTrace(settings.startupTracePath);
+			startupTracer.reset();
+		}
+
 		mainLoop();
 		cleanup();
 	}
 
 private:
-	GLFWwindow* window;
+	AppSettings settings;
+
+	std::unique_ptr<Window> window;
+	// Created first and destroyed last on the main thread, which becomes its worker 0
+	std::unique_ptr<JobSystem> jobSystem;
+	// Animation, upload preparation, culling and recording of the current frame
+	JobGraph frameGraph;
+	std::unique_ptr<Device> device;
+	std::unique_ptr<SwapChain> swapChain;
+	std::unique_ptr<PipelineCache> pipelineCache;
+	std::unique_ptr<Pipeline> pipelineFactory;
+	std::unique_ptr<Profiler> profiler;
+	std::unique_ptr<PipelineStatistics> pipelineStatistics;
+	std::unique_ptr<Model> model;
+	std::unique_ptr<GpuCuller> gpuCuller;
+	// Only with --cpu-culling. The first visibleCount entries of visibleObjects are the scene objects recorded this frame
+	std::unique_ptr<Scene> scene;
+	std::vector<uint32_t> visibleObjects;
+	uint32_t visibleCount = 0;
+	// Only with --animate on devices without unified memory
+	std::unique_ptr<StagingRing> stagingRing;
+	std::vector<Model::Instance> animatedInstances;
+
+	// One command buffer per frame in flight, so the CPU can record frame N+1 while the GPU executes frame N
+	std::vector<VkCommandBuffer> commandBuffers;
+	// Used instead of commandBuffers in static scene mode
+	std::unique_ptr<CommandBufferCache> commandBufferCache;
+	// Fills the render pass of commandBuffers from worker threads when enabled
+	std::unique_ptr<ParallelCommandRecorder> commandRecorder;
+
+	// Only with --bindless on devices supporting descriptor indexing, it owns pipelineLayout then
+	std::unique_ptr<BindlessDescriptors> bindless;
+	// Only with --textures and bindless, the draws sample the handles it currently publishes
+	std::unique_ptr<TextureStreamer> textureStreamer;
+	// Per-frame uniform data, bound by dynamic offset. frameConstantsOffset is the current frame's FrameConstants
+	std::unique_ptr<UniformRing> uniformRing;
+	uint32_t frameConstantsOffset = 0;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline graphicsPipeline;
+	// Depth only, VK_NULL_HANDLE without the depth pre-pass
+	VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
+	// Compiling from createGraphicsPipeline until waitForGraphicsPipeline
+	std::shared_future<VkPipeline> graphicsPipelineFuture;
+	std::shared_future<VkPipeline> depthPrepassFuture;
+	std::chrono::steady_clock::time_point pipelineStartTime;
+
+	// Offset x, offset y, zoom, unused. Written to the frame constants and pushed to the culling pass
+	float view[4];
+
+	// Frame uniform block of the vertex shaders, std140
+	struct FrameConstants
+	{
+		float view[4];
+	};
 
-	VkInstance instance;
-	VkPhysicalDevice physicalDevice;
-	VkSurfaceKHR surface;
-	VkDevice device;
+	// Per-draw push constants of bindless.vert, image and sampler are only read by textured.frag
+	struct BindlessDrawConstants
+	{
+		uint32_t instanceBuffer;
+		uint32_t image;
+		uint32_t sampler;
+	};
 
-	VkSwapchainKHR swapchain;
-	std::vector<VkImage> images;
-	std::vector<VkImageView> imageViews;
-	std::vector<VkFramebuffer> framebuffers;
+	void initWindow()
+	{
+		if (!settings.headless) {
+			window = std::make_unique<Window>(WIDTH, HEIGHT, "Vulkan");
+		}
+	}
 
-	VkCommandPool commandPool;
-	VkCommandBuffer commandBuffer;
+	// Independent steps overlap: the pipeline cache loads while the swapchain is created, and the pipelines
+	// compile on the factory threads while the model is uploaded and the command buffers are allocated
+	void initVulkan()
+	{
+		jobSystem = std::make_unique<JobSystem>(settings.jobThreads);
+		device = std::make_unique<Device>(window ? window->getWindow() : nullptr);
 
-	VkSemaphore imageAvailableSemaphore;
-	VkSemaphore renderFinishedSemaphore;
+		std::future<std::unique_ptr<PipelineCache>> pipelineCacheFuture;
+		if (!settings.pipelineCachePath.empty())
+		{
+			pipelineCacheFuture = std::async(std::launch::async, [this]() {
+				return std::make_unique<PipelineCache>(*device, settings.pipelineCachePath);
+			});
+		}
 
-	VkRenderPass renderPass;
-	VkPipeline graphicsPipeline;
+		VkExtent2D extent = window ? window->getExtent() : VkExtent2D{ WIDTH, HEIGHT };
+		swapChain = std::make_unique<SwapChain>(*device, extent, settings.framesInFlight, settings.presentMode, settings.swapchainImages,
+			settings.dynamicRendering, settings.sampleCount);
+		if (settings.dynamicRendering && !swapChain->usesDynamicRendering())
+			std::cout << "VK_KHR_dynamic_rendering is not supported, using the render pass" << std::endl;
+		if (settings.sampleCount != VK_SAMPLE_COUNT_1_BIT)
+		{
+			std::cout << "MSAA " << swapChain->getSampleCount() << "x";
+			if (swapChain->getSampleCount() != settings.sampleCount)
+				std::cout << " (" << settings.sampleCount << "x is not supported)";
+			std::cout << (swapChain->hasLazilyAllocatedAttachments() ? ", lazily allocated attachments" : ", no lazily allocated memory") << std::endl;
+		}
+		if (!settings.headless)
+		{
+			std::cout << "Present mode " << presentModeName(swapChain->getPresentMode()) << " with " << swapChain->imageCount() << " images";
+			if (swapChain->getPresentMode() != settings.presentMode)
+				std::cout << " (" << presentModeName(settings.presentMode) << " is not supported)";
+			std::cout << std::endl;
+		}
+		if (pipelineCacheFuture.valid())
+			pipelineCache = pipelineCacheFuture.get();
 
-	void initWindow()
+		createGraphicsPipeline();
+		{
+			StartupTracer::Scope scope("createModel");
+			createModel();
+		}
+		{
+			StartupTracer::Scope scope("createTextures");
+			createTextures();
+		}
+		{
+			StartupTracer::Scope scope("createCommandBuffers");
+			createCommandBuffers();
+		}
+
+		if (!settings.profileReportPath.empty() || !settings.profileTracePath.empty()) {
+			profiler = std::make_unique<Profiler>(*device, swapChain->getFramesInFlight());
+		}
+		if (settings.overdrawStats)
+			pipelineStatistics = std::make_unique<PipelineStatistics>(*device, swapChain->getFramesInFlight());
+
+		waitForGraphicsPipeline();
+	}
+
+	// Starts compiling the pipelines, waitForGraphicsPipeline collects them
+	void createGraphicsPipeline()
 	{
-		glfwInit();
+		StartupTracer::Scope scope("createGraphicsPipeline");
+
+		// Replayed command buffers keep the offset they were recorded with, so static scenes use the persistent region
+		uniformRing = std::make_unique<UniformRing>(*device, swapChain->getFramesInFlight(), UNIFORM_BYTES_PER_FRAME, sizeof(FrameConstants),
+			VK_SHADER_STAGE_VERTEX_BIT, settings.staticScene ? sizeof(FrameConstants) : 0);
+		VkDescriptorSetLayout frameSetLayout = uniformRing->getDescriptorSetLayout();
+
+		if (settings.bindless && BindlessDescriptors::isSupported(*device))
+		{
+			bindless = std::make_unique<BindlessDescriptors>(*device, std::vector<VkDescriptorSetLayout>{ frameSetLayout });
+			pipelineLayout = bindless->getPipelineLayout();
+		}
+		else
+		{
+			if (settings.bindless)
+				std::cout << "Descriptor indexing is not supported, binding the instances as vertex attributes" << std::endl;
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &frameSetLayout;
+
+			if (vkCreatePipelineLayout(device->getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create pipeline layout!");
+		}
+
+		VkPipelineCache cache = pipelineCache ? pipelineCache->getCache() : VK_NULL_HANDLE;
+		pipelineFactory = std::make_unique<Pipeline>(*device, cache, settings.pipelineThreads);
+
+		PipelineConfigInfo config;
+		config.vertFilePath = bindless ? "shaders/vert_bindless.spv" : "shaders/vert.spv";
+		config.fragFilePath = bindless && settings.textureCount > 0 ? "shaders/frag_textured.spv" : "shaders/frag.spv";
+		config.pipelineLayout = pipelineLayout;
+		config.renderPass = swapChain->getRenderPass();
+		config.colorFormat = swapChain->getImageFormat();
+		config.depthFormat = swapChain->getDepthFormat();
+		config.sampleCount = swapChain->getSampleCount();
+		config.bindingDescriptions = Model::getBindingDescriptions(bindless != nullptr);
+		config.attributeDescriptions = Model::getAttributeDescriptions(bindless != nullptr);
+
+		pipelineStartTime = std::chrono::steady_clock::now();
+
+		if (settings.depthPrepass)
+		{
+			PipelineConfigInfo depthPrepassConfig = config;
+			depthPrepassConfig.fragFilePath.clear();
+			depthPrepassFuture = pipelineFactory->createGraphicPipeline(depthPrepassConfig);
 
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+			// The pre-pass already wrote the nearest depth, only the fragments matching it get shaded
+			config.depthWrite = false;
+			config.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		}
 
-		window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+		graphicsPipelineFuture = pipelineFactory->createGraphicPipeline(config);
 	}
 
-	void initVulkan()
+	// Only the pipelines needed for the first frame are waited on, further variants keep compiling in the background
+	void waitForGraphicsPipeline()
 	{
-		createInstance();
-		pickPhysicalDevice();
-		createSurface();
-		createDevice();
-		createSwapchain();
-		createImageView();
-		createRenderPass();
-		createGraphicsPipeline();
-		createSemaphores();
-		createCommandPool();
-		createCommandBuffer();
-		createFramebuffers();
+		StartupTracer::Scope scope("waitForGraphicsPipeline");
+
+		graphicsPipeline = graphicsPipelineFuture.get();
+		if (depthPrepassFuture.valid())
+			depthPrepassPipeline = depthPrepassFuture.get();
+		graphicsPipelineFuture = std::shared_future<VkPipeline>();
+		depthPrepassFuture = std::shared_future<VkPipeline>();
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStartTime).count();
+		const char* cacheState = !pipelineCache ? "no cache" : pipelineCache->isWarm() ? "warm cache" : "cold cache";
+		std::cout << (depthPrepassPipeline != VK_NULL_HANDLE ? "Graphics pipelines" : "Graphics pipeline") << " created in " << milliseconds << " ms (" << cacheState << ", "
+			<< pipelineFactory->getThreadCount() << " compile threads)" << std::endl;
 	}
 
-	void createInstance()
+	void createModel()
 	{
-		VkApplicationInfo appInfo = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
-		appInfo.apiVersion = VK_API_VERSION_1_2;
+		std::vector<Model::Vertex> vertices = {
+			{ { 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+			{ { 0.5f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
+			{ { -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }
+		};
+
+		// Instances fill a square grid over the whole viewport, a single instance covers it like the original triangle.
+		// Every depth layer repeats the grid exactly, so each layer hides the ones behind it
+		uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(settings.instanceCount))));
+		float cellSize = 2.0f / columns;
+
+		std::vector<Model::Instance> instances(static_cast<size_t>(settings.instanceCount) * settings.depthLayers);
+		for (uint32_t layer = 0; layer < settings.depthLayers; ++layer)
+		{
+			for (uint32_t i = 0; i < settings.instanceCount; ++i)
+			{
+				uint32_t column = i % columns;
+				uint32_t row = i / columns;
+
+				Model::Instance& instance = instances[static_cast<size_t>(layer) * settings.instanceCount + i];
+				instance.transform[0] = -1.0f + (column + 0.5f) * cellSize;
+				instance.transform[1] = -1.0f + (row + 0.5f) * cellSize;
+				instance.transform[2] = columns == 1 ? 1.0f : cellSize;
+				instance.transform[3] = columns == 1 ? 0.0f : i * 0.01f;
+
+				uint32_t red = columns == 1 ? 255 : 64 + column * 191 / columns;
+				uint32_t green = columns == 1 ? 255 : 64 + row * 191 / columns;
+				uint32_t blue = 255 - layer * 191 / settings.depthLayers;
+				instance.color = red | (green << 8) | (blue << 16) | (255u << 24);
+
+				// Layer 0 is the farthest, all layers stay strictly inside the depth range
+				instance.depth = static_cast<float>(settings.depthLayers - layer) / (settings.depthLayers + 1);
+			}
+		}
 
-		VkInstanceCreateInfo createInfo = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
-		createInfo.pApplicationInfo = &appInfo;
-		if (enableValidationLayers)
+		// Draws are contiguous instance ranges, so sorting the instances orders the draws as well.
+		// Stable, so the grid order within a layer is kept
+		if (settings.frontToBack)
 		{
-			createInfo.ppEnabledLayerNames = validationLayers.data();
-			createInfo.enabledLayerCount = validationLayers.size();
+			std::stable_sort(instances.begin(), instances.end(),
+				[](const Model::Instance& a, const Model::Instance& b) { return a.depth < b.depth; });
 		}
-		createInfo.ppEnabledExtensionNames = instanceExtensions.data();
-		createInfo.enabledExtensionCount = instanceExtensions.size();
 
-		if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create intance!");
-	}
+		model = std::make_unique<Model>(*device, vertices, instances);
 
-	void pickPhysicalDevice()
-	{
-		uint32_t physicalDeviceCount;
-		vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+		if (settings.animate)
+		{
+			model->enableInstanceStreaming(swapChain->getFramesInFlight());
+			if (!model->isStreamingDirect())
+				stagingRing = std::make_unique<StagingRing>(*device, swapChain->getFramesInFlight(), sizeof(Model::Instance) * instances.size());
+			animatedInstances = instances;
+			std::cout << "Streaming instances " << (model->isStreamingDirect() ? "directly into device memory" : "through the staging ring") << std::endl;
+		}
+		if (bindless)
+			model->enableBindless(*bindless);
 
-		std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-		vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
+		view[0] = 0.0f;
+		view[1] = 0.0f;
+		view[2] = settings.zoom;
+		view[3] = 0.0f;
 
-		physicalDevice = physicalDevices[0];
+		if (settings.staticScene)
+		{
+			FrameConstants* constants = static_cast<FrameConstants*>(uniformRing->allocatePersistent(sizeof(FrameConstants), frameConstantsOffset));
+			std::copy(view, view + 4, constants->view);
+			uniformRing->flush();
+		}
+
+		if (settings.gpuCulling)
+			createGpuCuller(instances);
+		if (settings.cpuCulling)
+			createScene(instances);
 	}
 
-	void createSurface()
+	// Textures are baked into the working directory on the first run, later runs only map the files.
+	// Only their tails are uploaded here, the rest streams in while rendering
+	void createTextures()
 	{
-		if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create window surface!");
+		if (settings.textureCount == 0)
+			return;
+		if (!bindless)
+		{
+			std::cout << "Descriptor indexing is not supported, drawing without textures" << std::endl;
+			return;
+		}
+
+		textureStreamer = std::make_unique<TextureStreamer>(*device, *bindless, static_cast<VkDeviceSize>(settings.textureBudgetMegabytes) * 1024 * 1024);
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, 0, surface, &presentSupport);
+		for (uint32_t i = 0; i < settings.textureCount; ++i)
+		{
+			std::string path = "streamed_texture_" + std::to_string(i) + ".vtex";
+			try {
+				textureStreamer->addTexture(path);
+			}
+			catch (const std::runtime_error&) {
+				// Missing or from an older format version
+				bakeTexture(path, i);
+				textureStreamer->addTexture(path);
+			}
+		}
 
-		if (!presentSupport)
-			throw std::runtime_error("Physical device not support presentation!");
+		std::cout << "Streaming " << settings.textureCount << " textures within " << textureStreamer->getBudget() / (1024 * 1024) << " MiB" << std::endl;
 	}
 
-	void createDevice()
+	// A tinted checkerboard under thin diagonal lines, which blur away in the lower mips so refinement is visible
+	static void bakeTexture(const std::string& path, uint32_t seed)
 	{
-		float queuePriorities[] = { 1.0f };
+		uint32_t red = 128 + seed * 97 % 128;
+		uint32_t green = 128 + seed * 57 % 128;
+		uint32_t blue = 128 + seed * 31 % 128;
+		uint32_t tint = red | (green << 8) | (blue << 16) | (255u << 24);
 
-		VkDeviceQueueCreateInfo queueInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
-		queueInfo.queueFamilyIndex = 0;
-		queueInfo.queueCount = 1;
-		queueInfo.pQueuePriorities = queuePriorities;
-
-		VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
-		createInfo.pQueueCreateInfos = &queueInfo;
-		createInfo.queueCreateInfoCount = 1;
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-		createInfo.enabledExtensionCount = deviceExtensions.size();
+		std::vector<uint32_t> pixels(static_cast<size_t>(TEXTURE_SIZE) * TEXTURE_SIZE);
+		for (uint32_t y = 0; y < TEXTURE_SIZE; ++y)
+		{
+			for (uint32_t x = 0; x < TEXTURE_SIZE; ++x)
+			{
+				bool checker = ((x / 64) + (y / 64)) % 2 == 0;
+				bool line = (x + y) % 16 < 2;
+				pixels[static_cast<size_t>(y) * TEXTURE_SIZE + x] = line ? 0xFF202020 : checker ? tint : 0xFFFFFFFF;
+			}
+		}
 
-		if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create logical device!");
+		TextureContainer::bake(path, TEXTURE_SIZE, TEXTURE_SIZE, pixels);
 	}
 
-	void createSwapchain()
+	// Center and radius of the circle around the instances of a draw, and the center and half extent of their depths
+	void getDrawBounds(const std::vector<Model::Instance>& instances, uint32_t firstInstance, uint32_t instanceCount,
+		float center[3], float& radius, float& depthExtent)
 	{
-		VkSwapchainCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
-		createInfo.surface = surface;
-		createInfo.minImageCount = 2;
-		createInfo.imageFormat = VK_FORMAT_B8G8R8A8_SRGB;
-		createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-		createInfo.imageExtent.height = HEIGHT;
-		createInfo.imageExtent.width = WIDTH;
-		createInfo.imageArrayLayers = 1;
-		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-		createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
-		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-		createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		float minimum[3] = { instances[firstInstance].transform[0], instances[firstInstance].transform[1], instances[firstInstance].depth };
+		float maximum[3] = { minimum[0], minimum[1], minimum[2] };
+		for (uint32_t i = firstInstance; i < firstInstance + instanceCount; ++i)
+		{
+			const float position[3] = { instances[i].transform[0], instances[i].transform[1], instances[i].depth };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = std::min(minimum[axis], position[axis]);
+				maximum[axis] = std::max(maximum[axis], position[axis]);
+			}
+		}
 
-		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create swapchain!");
+		for (int axis = 0; axis < 3; ++axis)
+			center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+
+		// A triangle reaches at most sqrt(0.5) of its scale away from its center, all instances share one scale
+		float extentX = (maximum[0] - minimum[0]) * 0.5f;
+		float extentY = (maximum[1] - minimum[1]) * 0.5f;
+		radius = std::sqrt(extentX * extentX + extentY * extentY) + 0.71f * instances[firstInstance].transform[2];
+		depthExtent = (maximum[2] - minimum[2]) * 0.5f;
 	}
 
-	void createImageView()
+	// Every draw becomes one cullable object bounded by a circle around its instances
+	void createGpuCuller(const std::vector<Model::Instance>& instances)
 	{
-		uint32_t swapchainImageCount;
-		vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, nullptr);
-		images.resize(swapchainImageCount);
-		vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, images.data());
+		std::vector<GpuCuller::Object> objects;
+		objects.reserve(settings.drawCount);
 
-		imageViews.resize(swapchainImageCount);
-		for (int i = 0; i < images.size(); i++)
+		for (uint32_t draw = 0; draw < settings.drawCount; ++draw)
 		{
-			VkImageViewCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
-			createInfo.image = images[i];
-			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			createInfo.format = VK_FORMAT_B8G8R8A8_SRGB;
-			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			createInfo.subresourceRange.levelCount = 1;
-			createInfo.subresourceRange.layerCount = 1;
-
-			if (vkCreateImageView(device, &createInfo, nullptr, &imageViews[i]) != VK_SUCCESS)
-				throw std::runtime_error("Failed to create image view!");
+			uint32_t firstInstance, instanceCount;
+			getDrawInstances(draw, firstInstance, instanceCount);
+			if (instanceCount == 0)
+				continue;
+
+			float center[3], radius, depthExtent;
+			getDrawBounds(instances, firstInstance, instanceCount, center, radius, depthExtent);
+
+			GpuCuller::Object object{};
+			object.bounds[0] = center[0];
+			object.bounds[1] = center[1];
+			object.bounds[2] = radius;
+			object.firstInstance = firstInstance;
+			object.instanceCount = instanceCount;
+
+			objects.push_back(object);
 		}
+
+		gpuCuller = std::make_unique<GpuCuller>(*device, *pipelineFactory, swapChain->getFramesInFlight(), objects, model->getVertexCount(),
+			settings.asyncCompute);
+		if (settings.asyncCompute && !gpuCuller->isAsync())
+			std::cout << "No dedicated compute queue, culling on the graphic queue" << std::endl;
 	}
 
-	void createRenderPass()
+	// Same objects as the GPU culler, bounded by spheres that also cover the depth range of their instances
+	void createScene(const std::vector<Model::Instance>& instances)
 	{
-		VkAttachmentDescription colorAttachment{};
-		colorAttachment.format = VK_FORMAT_B8G8R8A8_SRGB;
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		VkAttachmentReference colorAttachmentRef{};
-		colorAttachmentRef.attachment = 0;
-		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		scene = std::make_unique<Scene>();
 
-		VkSubpassDescription subpass = { };
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
+		for (uint32_t draw = 0; draw < settings.drawCount; ++draw)
+		{
+			uint32_t firstInstance, instanceCount;
+			getDrawInstances(draw, firstInstance, instanceCount);
+			if (instanceCount == 0)
+				continue;
+
+			float center[3], radius, depthExtent;
+			getDrawBounds(instances, firstInstance, instanceCount, center, radius, depthExtent);
+			scene->addObject(center, std::sqrt(radius * radius + depthExtent * depthExtent), firstInstance, instanceCount);
+		}
 
-		VkRenderPassCreateInfo createInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-		createInfo.attachmentCount = 1;
-		createInfo.pAttachments = &colorAttachment;
-		createInfo.subpassCount = 1;
-		createInfo.pSubpasses = &subpass;
+		std::cout << "CPU culling " << scene->getObjectCount() << " objects with " << Scene::getCullPathName(scene->getCullPath()) << std::endl;
+	}
 
-		if (vkCreateRenderPass(device, &createInfo, nullptr, &renderPass) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create rednder pass!");
+	// Draws split the instances as evenly as possible
+	void getDrawInstances(uint32_t draw, uint32_t& firstInstance, uint32_t& instanceCount)
+	{
+		uint64_t totalInstances = model->getInstanceCount();
+		firstInstance = static_cast<uint32_t>(draw * totalInstances / settings.drawCount);
+		instanceCount = static_cast<uint32_t>((draw + 1) * totalInstances / settings.drawCount) - firstInstance;
 	}
 
-	void createGraphicsPipeline()
+	void createCommandBuffers()
 	{
-		std::vector<char> vertShaderCode = readFile("shaders/vert.spv");
-		std::vector<char> fragShaderCode = readFile("shaders/frag.spv");
+		if (settings.staticScene)
+		{
+			createCommandBufferCache();
+			return;
+		}
 
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+		if (settings.recordThreads > 0) {
+			commandRecorder = std::make_unique<ParallelCommandRecorder>(*device, *jobSystem, swapChain->getFramesInFlight(), settings.recordThreads);
+		}
 
-		VkPipelineShaderStageCreateInfo vertShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
-		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
-		vertShaderStageInfo.pName = "main";
+		commandBuffers.resize(swapChain->getFramesInFlight());
 
-		VkPipelineShaderStageCreateInfo fragShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
-		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
-		fragShaderStageInfo.pName = "main";
+		VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		allocateInfo.commandPool = device->getCommandPool();
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
-		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+		if (vkAllocateCommandBuffers(device->getDevice(), &allocateInfo, commandBuffers.data()) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate command buffers!");
+	}
 
-		VkPipelineVertexInputStateCreateInfo vertexInputInfo = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+	void createCommandBufferCache()
+	{
+		commandBufferCache = std::make_unique<CommandBufferCache>(*device, swapChain->imageCount(),
+			[this](VkCommandBuffer commandBuffer, uint32_t imageIndex) { recordCommandBuffer(commandBuffer, imageIndex, nullptr); });
+	}
 
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
-		inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+	// Only what references the swapchain images is rebuilt, pipelines use dynamic viewport and scissor
+	void recreateSwapChain()
+	{
+		// A minimized window has nothing to render into
+		VkExtent2D extent = window->getExtent();
+		while ((extent.width == 0 || extent.height == 0) && !window->shouldClose())
+		{
+			glfwWaitEvents();
+			extent = window->getExtent();
+		}
+		if (window->shouldClose())
+			return;
 
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = WIDTH;
-		viewport.height = HEIGHT;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
+		window->resetResizedFlag();
 
-		VkRect2D scissor;
-		scissor.offset = { 0, 0 };
-		scissor.extent.width = WIDTH;
-		scissor.extent.height = HEIGHT;
+		size_t imageCount = swapChain->imageCount();
+		swapChain->recreate(extent);
 
-		VkPipelineViewportStateCreateInfo viewportStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
-		viewportStageInfo.viewportCount = 1;
-		viewportStageInfo.pViewports = &viewport;
-		viewportStageInfo.scissorCount = 1;
-		viewportStageInfo.pScissors = &scissor;
+		if (commandBufferCache)
+		{
+			if (swapChain->imageCount() == imageCount)
+				commandBufferCache->markDirty(CommandBufferCache::DIRTY_RENDER_TARGETS);
+			else
+				createCommandBufferCache();
+		}
+	}
 
-		VkPipelineRasterizationStateCreateInfo rasterizationStateInfo = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
-		rasterizationStateInfo.depthClampEnable = VK_FALSE;
-		rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
-		rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizationStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizationStateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-		rasterizationStateInfo.depthBiasEnable = VK_FALSE;
-		rasterizationStateInfo.lineWidth = 1.0f;
+	void mainLoop()
+	{
+		uint64_t renderedFrames = 0;
+		auto startTime = std::chrono::steady_clock::now();
 
-		VkPipelineMultisampleStateCreateInfo multisampling = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
-		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		multisampling.sampleShadingEnable = VK_FALSE;
+		while (settings.frameCount == 0 || renderedFrames < settings.frameCount)
+		{
+			if (window)
+			{
+				if (window->shouldClose())
+					break;
+			}
 
-		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_FALSE;
+			if (!settings.lowLatency)
+				pollInput();
 
-		VkPipelineColorBlendStateCreateInfo colorBlending = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
-		colorBlending.logicOpEnable = VK_FALSE;
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
+			drawFrame();
+			++renderedFrames;
+		}
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+		vkDeviceWaitIdle(device->getDevice());
 
-		VkPipelineLayout pipelineLayout;
-		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create pipeline layout!");
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		if (seconds > 0.0)
+		{
+			std::cout << renderedFrames << " frames in " << seconds << " s (" << renderedFrames / seconds << " fps)" << std::endl;
+			std::cout << model->getInstanceCount() << " instances in " << settings.drawCount << " draws, "
+				<< renderedFrames * model->getInstanceCount() / seconds << " instances/s" << std::endl;
+		}
+		if (commandBufferCache)
+			std::cout << commandBufferCache->getRecordCount() << " command buffer recordings" << std::endl;
+		if (scene)
+			std::cout << visibleCount << " of " << scene->getObjectCount() << " objects visible in the last frame" << std::endl;
 
-		VkGraphicsPipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
-		createInfo.stageCount = 2;
-		createInfo.pStages = shaderStages;
-		createInfo.pVertexInputState = &vertexInputInfo;
-		createInfo.pInputAssemblyState = &inputAssemblyInfo;
-		createInfo.pViewportState = &viewportStageInfo;
-		createInfo.pRasterizationState = &rasterizationStateInfo;
-		createInfo.pMultisampleState = &multisampling;
-		createInfo.pDepthStencilState = nullptr;
-		createInfo.pColorBlendState = &colorBlending;
-		createInfo.pDynamicState = nullptr;
-		createInfo.layout = pipelineLayout;
-		createInfo.renderPass = renderPass;
-		createInfo.subpass = 0;
-		createInfo.basePipelineHandle = VK_NULL_HANDLE;
+		if (textureStreamer)
+		{
+			const TextureStreamer::Stats& textureStats = textureStreamer->getStats();
+			const double mebibyte = 1024.0 * 1024.0;
+			std::cout << "Texture streaming: " << textureStats.uploadedMips << " mips, " << textureStats.uploadedBytes / mebibyte << " MiB uploaded, "
+				<< textureStats.evictions << " evictions, " << textureStats.residentBytes / mebibyte << " MiB resident, "
+				<< textureStats.peakResidentBytes / mebibyte << " MiB peak" << std::endl;
+			if (textureStats.firstMipCount > 0)
+			{
+				std::cout << "First mip visible after " << textureStats.firstMipMilliseconds / textureStats.firstMipCount << " ms average, "
+					<< textureStats.maxFirstMipMilliseconds << " ms max" << std::endl;
+			}
+			if (textureStats.fullResolutionCount > 0)
+			{
+				std::cout << "Full resolution visible after " << textureStats.fullResolutionMilliseconds / textureStats.fullResolutionCount << " ms average, "
+					<< textureStats.maxFullResolutionMilliseconds << " ms max (" << textureStats.fullResolutionCount << " textures)" << std::endl;
+			}
+		}
+
+		if (pipelineStatistics)
+		{
+			pipelineStatistics->collectPendingResults();
+			const PipelineStatistics::Totals& totals = pipelineStatistics->getTotals();
+			if (totals.frameCount > 0)
+			{
+				// Invocations per pixel is the overdraw, 1 means every covered pixel was shaded once
+				VkExtent2D extent = swapChain->getExtent();
+				double fragments = static_cast<double>(totals.fragmentInvocations) / totals.frameCount;
+				std::cout << "Fragment shader invocations (" << settings.depthLayers << " layers, "
+					<< (settings.frontToBack ? "front to back" : "back to front") << (settings.depthPrepass ? ", depth pre-pass" : "") << "): "
+					<< fragments << " per frame, " << fragments / (static_cast<double>(extent.width) * extent.height) << " per pixel, "
+					<< static_cast<double>(totals.vertexInvocations) / totals.frameCount << " vertex invocations per frame" << std::endl;
+			}
+		}
 
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create graphic pipeline!");
+		printMemoryStats();
 
-		vkDestroyShaderModule(device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(device, vertShaderModule, nullptr);
+		const SwapChain::LatencyStats& latency = swapChain->getLatencyStats();
+		if (latency.frameCount > 0)
+		{
+			std::cout << "Input to present latency (" << (settings.headless ? "headless" : presentModeName(swapChain->getPresentMode()))
+				<< (settings.lowLatency ? ", low latency" : "") << "): " << latency.totalMilliseconds / latency.frameCount
+				<< " ms average, " << latency.minimumMilliseconds << " ms min, " << latency.maximumMilliseconds << " ms max" << std::endl;
+		}
 	}
 
-	void createSemaphores()
+	// Taken while every resource is still alive, so it shows the peak of a steady frame loop
+	void printMemoryStats()
 	{
-		VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		MemoryStats stats = device->getAllocator().getStats();
+		const double mebibyte = 1024.0 * 1024.0;
 
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create imageAvailableSemaphore!");
+		std::cout << "Device memory: " << stats.deviceMemoryCount << " of " << stats.maxDeviceMemoryCount << " allocations, "
+			<< stats.dedicatedAllocationCount << " dedicated (" << stats.dedicatedBytes / mebibyte << " MiB)" << std::endl;
+		for (size_t i = 0; i < stats.memoryTypes.size(); ++i)
+		{
+			const MemoryTypeStats& typeStats = stats.memoryTypes[i];
+			if (typeStats.blockCount == 0)
+				continue;
 
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create renderFinishedSemaphore!");
+			std::cout << "  Memory type " << i << ": " << typeStats.allocationCount << " allocations in " << typeStats.blockCount << " blocks, "
+				<< typeStats.usedBytes / mebibyte << " of " << typeStats.blockBytes / mebibyte << " MiB used, largest free range "
+				<< typeStats.largestFreeRange / mebibyte << " MiB, fragmentation " << typeStats.fragmentation << std::endl;
+		}
 	}
 
-	void createCommandPool()
+	void pollInput()
 	{
-		VkCommandPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-		createInfo.queueFamilyIndex = 0;
-		createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-		if (vkCreateCommandPool(device, &createInfo, nullptr, &commandPool) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create command pool!");
+		if (window)
+			glfwPollEvents();
+		swapChain->markInput();
 	}
 
-	void createCommandBuffer()
+	void drawFrame()
 	{
-		VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-		allocateInfo.commandPool = commandPool;
-		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocateInfo.commandBufferCount = 1;
+		Profiler::CpuScope frameScope(profiler.get(), "frame");
 
-		if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
-			throw std::runtime_error("Failed to allocate command buffer!");
-	}
+		uint32_t imageIndex = 0;
+		VkResult result;
 
-	void createFramebuffers()
-	{
-		framebuffers.resize(imageViews.size());
+		if (settings.lowLatency)
+		{
+			// Trades GPU overlap between frames for input that is at most one frame old
+			Profiler::CpuScope scope(profiler.get(), "pace");
+			swapChain->waitForLastSubmittedFrame();
+		}
 
-		for (size_t i = 0; i < imageViews.size(); i++) {
-			VkImageView attachments[] = {
-				imageViews[i]
-			};
+		{
+			// Blocks only while the GPU still works on the frame that last used this slot
+			Profiler::CpuScope scope(profiler.get(), "acquire");
+			result = swapChain->acquireNextImage(&imageIndex);
+		}
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			recreateSwapChain();
+			return;
+		}
+		// A suboptimal image is still presentable, the swapchain is recreated after presenting it
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+			throw std::runtime_error("Failed to acquire swapchain image!");
+
+		// Acquiring can block on the presentation engine, input sampled after it is fresher
+		if (settings.lowLatency)
+			pollInput();
 
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount = 1;
-			framebufferInfo.pAttachments = attachments;
-			framebufferInfo.width = WIDTH;
-			framebufferInfo.height = HEIGHT;
-			framebufferInfo.layers = 1;
+		if (!commandBufferCache)
+			writeFrameConstants();
 
-			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
-				throw std::runtime_error("failed to create framebuffer!");
+		if (textureStreamer)
+		{
+			Profiler::CpuScope scope(profiler.get(), "textures");
+			textureStreamer->update();
 		}
-	}
 
-	static std::vector<char> readFile(const std::string& filename)
-	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		// The CPU work of the frame runs as a job graph across all cores. Recording waits for the
+		// upload it records the copies of, the culling submission overlaps with both
+		frameGraph.clear();
+		std::vector<JobGraph::NodeId> recordDependencies;
+
+		if (settings.animate)
+		{
+			JobGraph::NodeId animateNode = frameGraph.add([this]()
+			{
+				Profiler::CpuScope scope(profiler.get(), "animate");
+				animateInstances();
+			});
+			recordDependencies.push_back(frameGraph.add([this]()
+			{
+				Profiler::CpuScope scope(profiler.get(), "stream");
+				streamInstances();
+			}, { animateNode }));
+		}
 
-		if (!file.is_open())
-			throw std::runtime_error("Failed to open shader file!");
+		// Compute timeline value of this frame's culling, 0 when it runs on the graphic queue
+		uint64_t cullValue = 0;
+		if (gpuCuller && gpuCuller->isAsync())
+		{
+			frameGraph.add([this, &cullValue]()
+			{
+				Profiler::CpuScope scope(profiler.get(), "cull");
+				cullValue = gpuCuller->cullAsync(swapChain->getCurrentFrame(), view);
+			});
+		}
 
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
+		if (scene)
+		{
+			recordDependencies.push_back(frameGraph.add([this]()
+			{
+				Profiler::CpuScope scope(profiler.get(), "cpu cull");
+				visibleCount = scene->cull(Frustum::fromView(view), visibleObjects, jobSystem.get());
+			}));
+		}
 
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
+		VkCommandBuffer commandBuffer;
+		frameGraph.add([this, imageIndex, &commandBuffer]()
+		{
+			Profiler::CpuScope scope(profiler.get(), "record");
+			if (commandBufferCache)
+			{
+				commandBuffer = commandBufferCache->get(imageIndex);
+			}
+			else
+			{
+				commandBuffer = commandBuffers[swapChain->getCurrentFrame()];
+				vkResetCommandBuffer(commandBuffer, 0);
+				recordCommandBuffer(commandBuffer, imageIndex, profiler.get());
+			}
+		}, recordDependencies);
+
+		frameGraph.run(*jobSystem);
 
-		file.close();
+		{
+			Profiler::CpuScope scope(profiler.get(), "submit");
+			// --textures excludes --gpu-culling, so a frame waits on the compute or the transfer queue but never both
+			if (textureStreamer && textureStreamer->getPublishedValue() > 0)
+			{
+				swapChain->submitCommandBuffers(&commandBuffer, imageIndex, device->getTimeline(QueueType::Transfer), textureStreamer->getPublishedValue(),
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			}
+			else
+			{
+				VkSemaphore cullTimeline = cullValue > 0 ? device->getTimeline(QueueType::Compute) : VK_NULL_HANDLE;
+				swapChain->submitCommandBuffers(&commandBuffer, imageIndex, cullTimeline, cullValue, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+			}
+		}
 
-		return buffer;
+		{
+			Profiler::CpuScope scope(profiler.get(), "present");
+			result = swapChain->present(imageIndex);
+		}
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (window && window->wasResized()))
+			recreateSwapChain();
+		else if (result != VK_SUCCESS)
+			throw std::runtime_error("Failed to present swapchain image!");
 	}
 
-	VkShaderModule createShaderModule(const std::vector<char> code)
+	// The slot's previous frame has finished once its image is acquired, so its uniform region can be rewritten
+	void writeFrameConstants()
 	{
-		VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		uniformRing->beginFrame(swapChain->getCurrentFrame());
+		FrameConstants* constants = uniformRing->allocate<FrameConstants>(frameConstantsOffset);
+		std::copy(view, view + 4, constants->view);
+		uniformRing->flush();
+	}
 
-		VkShaderModule shaderModule;
-		vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule);
+	// A fixed step per frame keeps headless benchmarks reproducible. Rotation leaves the culling bounds valid
+	void animateInstances()
+	{
+		jobSystem->parallelFor(static_cast<uint32_t>(animatedInstances.size()), ANIMATE_BATCH_SIZE, [this](uint32_t first, uint32_t count)
+		{
+			for (uint32_t i = first; i < first + count; ++i)
+				animatedInstances[i].transform[3] += 0.02f;
+		});
+	}
 
-		return shaderModule;
+	void streamInstances()
+	{
+		if (stagingRing)
+			stagingRing->beginFrame(swapChain->getCurrentFrame());
+		model->streamInstances(swapChain->getCurrentFrame(), animatedInstances, stagingRing.get());
 	}
 
-	void mainLoop()
+	// GPU scopes are only written with a profiler, replayed buffers have no frame slot to put queries in
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, Profiler* gpuProfiler)
 	{
-		VkQueue presentQueue;
-		vkGetDeviceQueue(device, 0, 0, &presentQueue);
+		VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		if (!commandBufferCache)
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		while (!glfwWindowShouldClose(window))
-		{
-			glfwPollEvents();
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Failed to begin recording command buffer!");
 
-			uint32_t imageIndex = 0;
+		if (gpuProfiler) {
+			gpuProfiler->beginFrame(commandBuffer, swapChain->getCurrentFrame());
+			gpuProfiler->beginGpuScope(commandBuffer, "render pass");
+		}
 
-			VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		if (stagingRing)
+		{
+			if (gpuProfiler) gpuProfiler->beginGpuScope(commandBuffer, "upload");
+			stagingRing->recordCopies(commandBuffer);
+			if (gpuProfiler) gpuProfiler->endGpuScope(commandBuffer);
+		}
 
-			vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		VkClearColorValue color = { 0,0,0,1 };
+		VkClearValue clearColor = { color };
 
-			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		if (gpuCuller && gpuCuller->isAsync())
+		{
+			gpuCuller->acquire(commandBuffer, swapChain->getCurrentFrame());
+		}
+		else if (gpuCuller)
+		{
+			if (gpuProfiler) gpuProfiler->beginGpuScope(commandBuffer, "cull");
+			gpuCuller->cull(commandBuffer, swapChain->getCurrentFrame(), view);
+			if (gpuProfiler) gpuProfiler->endGpuScope(commandBuffer);
+		}
 
-			VkClearColorValue color = { 0,0,0,1 };
-			VkClearValue clearColor = { color };
+		if (pipelineStatistics)
+			pipelineStatistics->begin(commandBuffer, swapChain->getCurrentFrame());
 
-			VkImageSubresourceRange range = {};
-			range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			range.layerCount = 1;
-			range.levelCount = 1;
+		if (commandRecorder)
+		{
+			// Timestamps cannot be written between secondaries, the render pass scope covers them
+			commandRecorder->beginFrame(swapChain->getCurrentFrame());
+			const std::vector<VkCommandBuffer>& secondaryBuffers = commandRecorder->record(swapChain->getInheritanceInfo(imageIndex),
+				getRecordedDrawCount(),
+				[this](VkCommandBuffer secondaryBuffer, uint32_t firstDraw, uint32_t drawCount) { recordDraws(secondaryBuffer, firstDraw, drawCount); });
+
+			// Nothing to draw when culling left no object visible, and vkCmdExecuteCommands needs at least one buffer
+			bool hasSecondaries = !secondaryBuffers.empty();
+			swapChain->beginRendering(commandBuffer, imageIndex, clearColor, hasSecondaries);
+			if (hasSecondaries)
+				vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+		}
+		else
+		{
+			swapChain->beginRendering(commandBuffer, imageIndex, clearColor, false);
+
+			if (gpuProfiler) gpuProfiler->beginGpuScope(commandBuffer, "instances");
+			if (gpuCuller)
+				recordPasses(commandBuffer, [&]() { gpuCuller->draw(commandBuffer, swapChain->getCurrentFrame()); });
+			else
+				recordDraws(commandBuffer, 0, getRecordedDrawCount());
+			if (gpuProfiler) gpuProfiler->endGpuScope(commandBuffer);
+		}
 
-			VkRenderPassBeginInfo passBeginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-			passBeginInfo.renderPass = renderPass;
-			passBeginInfo.framebuffer = framebuffers[imageIndex];
-			passBeginInfo.renderArea.extent.height = HEIGHT;
-			passBeginInfo.renderArea.extent.width = WIDTH;
-			passBeginInfo.clearValueCount = 1;
-			passBeginInfo.pClearValues = &clearColor;
+		swapChain->endRendering(commandBuffer, imageIndex);
 
-			vkCmdBeginRenderPass(commandBuffer, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (pipelineStatistics)
+			pipelineStatistics->end(commandBuffer);
 
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		if (gpuProfiler) gpuProfiler->endGpuScope(commandBuffer);
 
-			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to record command buffer!");
+	}
 
-			vkCmdEndRenderPass(commandBuffer);
+	// Everything but the pipeline, both passes share the layout and the dynamic state
+	void bindDrawState(VkCommandBuffer commandBuffer)
+	{
+		VkExtent2D extent = swapChain->getExtent();
 
-			vkEndCommandBuffer(commandBuffer);
+		VkViewport viewport{};
+		viewport.width = static_cast<float>(extent.width);
+		viewport.height = static_cast<float>(extent.height);
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-			VkPipelineStageFlags submitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		VkRect2D scissor{};
+		scissor.extent = extent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-			VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &imageAvailableSemaphore;
-			submitInfo.pWaitDstStageMask = &submitStageMask;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandBuffer;
-			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.pSignalSemaphores = &renderFinishedSemaphore;
+		// Descriptor sets are bound once per command buffer whatever is drawn, only push constants change per draw
+		if (bindless)
+		{
+			BindlessDrawConstants constants;
+			constants.instanceBuffer = model->getInstanceBufferHandle();
+			bindless->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+			bindless->pushConstants(commandBuffer, &constants.instanceBuffer, sizeof(constants.instanceBuffer));
+			uniformRing->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, frameConstantsOffset);
+		}
+		else
+		{
+			uniformRing->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, frameConstantsOffset);
+		}
+		model->bind(commandBuffer);
+	}
 
-			vkQueueSubmit(presentQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	// With the depth pre-pass everything is drawn twice, depth only first and then shaded
+	template<typename DrawFunction>
+	void recordPasses(VkCommandBuffer commandBuffer, DrawFunction draw)
+	{
+		bindDrawState(commandBuffer);
 
-			VkPresentInfoKHR presentInfo{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-			presentInfo.swapchainCount = 1;
-			presentInfo.pSwapchains = &swapchain;
-			presentInfo.pImageIndices = &imageIndex;
-			presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
-			presentInfo.waitSemaphoreCount = 1;
+		if (depthPrepassPipeline != VK_NULL_HANDLE)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassPipeline);
+			draw();
+		}
 
-			vkQueuePresentKHR(presentQueue, &presentInfo);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		draw();
+	}
 
-			vkQueueWaitIdle(presentQueue);
+	// With CPU culling only the visible objects are recorded, otherwise every draw
+	uint32_t getRecordedDrawCount() const
+	{
+		return scene ? visibleCount : settings.drawCount;
+	}
 
-			vkResetCommandBuffer(commandBuffer, 0);
-		}
+	// Secondary buffers inherit no state, so every call binds everything it draws with. Each secondary runs
+	// its own pre-pass, so hidden fragments of a later range can still be shaded by an earlier one
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)
+	{
+		recordPasses(commandBuffer, [&]()
+		{
+			for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw)
+			{
+				uint32_t firstInstance, instanceCount;
+				uint32_t object = draw;
+				if (scene)
+				{
+					object = visibleObjects[draw];
+					firstInstance = scene->getFirstInstance(object);
+					instanceCount = scene->getInstanceCount(object);
+				}
+				else
+				{
+					getDrawInstances(draw, firstInstance, instanceCount);
+				}
+				if (instanceCount == 0)
+					continue;
+
+				// Only drawn textures are requested, so with culling the hidden ones become eviction candidates
+				if (textureStreamer)
+				{
+					uint32_t texture = object % textureStreamer->getTextureCount();
+					textureStreamer->request(texture);
+
+					uint32_t textureHandles[2] = { textureStreamer->getImageHandle(texture), textureStreamer->getSamplerHandle() };
+					bindless->pushConstants(commandBuffer, textureHandles, sizeof(textureHandles), offsetof(BindlessDrawConstants, image));
+				}
+				model->draw(commandBuffer, firstInstance, instanceCount);
+			}
+		});
 	}
 
 	void cleanup()
 	{
-		glfwDestroyWindow(window);
-
-		glfwTerminate();
+		if (profiler)
+		{
+			profiler->collectPendingResults();
+			if (!settings.profileReportPath.empty())
+				profiler->writeReport(settings.profileReportPath);
+			if (!settings.profileTracePath.empty())
+				profiler->writeChromeTrace(settings.profileTracePath);
+			profiler.reset();
+		}
+		pipelineStatistics.reset();
+
+		commandBufferCache.reset();
+		commandRecorder.reset();
+		frameGraph.clear();
+		if (!commandBuffers.empty())
+			vkFreeCommandBuffers(device->getDevice(), device->getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+
+		gpuCuller.reset();
+		scene.reset();
+		model.reset();
+		stagingRing.reset();
+		textureStreamer.reset();
+
+		pipelineFactory.reset();
+		if (bindless)
+			bindless.reset();
+		else
+			vkDestroyPipelineLayout(device->getDevice(), pipelineLayout, nullptr);
+		uniformRing.reset();
+
+		pipelineCache.reset();
+		swapChain.reset();
+		device.reset();
+		jobSystem.reset();
+		window.reset();
 	}
 };
 
-int main()
+static AppSettings parseArguments(int argc, char* argv[])
 {
-	HelloTriangleApplication app;
+	AppSettings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
 
+		if (arg == "--frames-in-flight" && i + 1 < argc)
+		{
+			settings.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--present-mode" && i + 1 < argc)
+		{
+			settings.presentMode = parsePresentMode(argv[++i]);
+		}
+		else if (arg == "--swapchain-images" && i + 1 < argc)
+		{
+			settings.swapchainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--dynamic-rendering")
+		{
+			settings.dynamicRendering = true;
+		}
+		else if (arg == "--msaa" && i + 1 < argc)
+		{
+			unsigned long samples = std::stoul(argv[++i]);
+			if (samples != 1 && samples != 2 && samples != 4 && samples != 8)
+				throw std::runtime_error("--msaa must be 1, 2, 4 or 8");
+			settings.sampleCount = static_cast<VkSampleCountFlagBits>(samples);
+		}
+		else if (arg == "--low-latency")
+		{
+			settings.lowLatency = true;
+		}
+		else if (arg == "--headless")
+		{
+			settings.headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			settings.frameCount = std::stoull(argv[++i]);
+		}
+		else if (arg == "--pipeline-cache" && i + 1 < argc)
+		{
+			settings.pipelineCachePath = argv[++i];
+		}
+		else if (arg == "--no-pipeline-cache")
+		{
+			settings.pipelineCachePath.clear();
+		}
+		else if (arg == "--pipeline-threads" && i + 1 < argc)
+		{
+			settings.pipelineThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--static-scene")
+		{
+			settings.staticScene = true;
+		}
+		else if (arg == "--profile" && i + 1 < argc)
+		{
+			settings.profileReportPath = argv[++i];
+		}
+		else if (arg == "--trace" && i + 1 < argc)
+		{
+			settings.profileTracePath = argv[++i];
+		}
+		else if (arg == "--instances" && i + 1 < argc)
+		{
+			settings.instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			if (settings.instanceCount == 0)
+				throw std::runtime_error("--instances must be at least 1");
+		}
+		else if (arg == "--draws" && i + 1 < argc)
+		{
+			settings.drawCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			if (settings.drawCount == 0)
+				throw std::runtime_error("--draws must be at least 1");
+		}
+		else if (arg == "--record-threads" && i + 1 < argc)
+		{
+			settings.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--gpu-culling")
+		{
+			settings.gpuCulling = true;
+		}
+		else if (arg == "--cpu-culling")
+		{
+			settings.cpuCulling = true;
+		}
+		else if (arg == "--cull-benchmark")
+		{
+			settings.cullBenchmark = true;
+		}
+		else if (arg == "--async-compute")
+		{
+			settings.asyncCompute = true;
+		}
+		else if (arg == "--animate")
+		{
+			settings.animate = true;
+		}
+		else if (arg == "--zoom" && i + 1 < argc)
+		{
+			settings.zoom = std::stof(argv[++i]);
+		}
+		else if (arg == "--depth-layers" && i + 1 < argc)
+		{
+			settings.depthLayers = static_cast<uint32_t>(std::stoul(argv[++i]));
+			if (settings.depthLayers == 0)
+				throw std::runtime_error("--depth-layers must be at least 1");
+		}
+		else if (arg == "--front-to-back")
+		{
+			settings.frontToBack = true;
+		}
+		else if (arg == "--depth-prepass")
+		{
+			settings.depthPrepass = true;
+		}
+		else if (arg == "--overdraw-stats")
+		{
+			settings.overdrawStats = true;
+		}
+		else if (arg == "--job-threads" && i + 1 < argc)
+		{
+			settings.jobThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--job-benchmark")
+		{
+			settings.jobBenchmark = true;
+		}
+		else if (arg == "--bindless")
+		{
+			settings.bindless = true;
+		}
+		else if (arg == "--textures" && i + 1 < argc)
+		{
+			settings.textureCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--texture-budget" && i + 1 < argc)
+		{
+			settings.textureBudgetMegabytes = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--startup-summary")
+		{
+			settings.traceStartup = true;
+		}
+		else if (arg == "--startup-trace" && i + 1 < argc)
+		{
+			settings.traceStartup = true;
+			settings.startupTracePath = argv[++i];
+		}
+		else if (arg == "--startup-threshold" && i + 1 < argc)
+		{
+			settings.startupThresholdMilliseconds = std::stod(argv[++i]);
+		}
+		else {
+			throw std::runtime_error("Unknown argument: " + arg);
+		}
+	}
+
+	// The culling results live in per-frame buffers and end in a single indirect draw
+	if (settings.gpuCulling && (settings.staticScene || settings.recordThreads > 0))
+		throw std::runtime_error("--gpu-culling cannot be combined with --static-scene or --record-threads");
+	// Replayed command buffers keep binding the instance buffer they were recorded with
+	if (settings.animate && settings.staticScene)
+		throw std::runtime_error("--animate cannot be combined with --static-scene");
+	// Replayed command buffers would keep drawing what was visible when they were recorded
+	if (settings.cpuCulling && (settings.gpuCulling || settings.staticScene))
+		throw std::runtime_error("--cpu-culling cannot be combined with --gpu-culling or --static-scene");
+	if (settings.asyncCompute && !settings.gpuCulling)
+		throw std::runtime_error("--async-compute requires --gpu-culling");
+	// The query would have to be active across secondaries or in a replayed buffer without a frame slot
+	if (settings.overdrawStats && (settings.staticScene || settings.recordThreads > 0))
+		throw std::runtime_error("--overdraw-stats cannot be combined with --static-scene or --record-threads");
+	// Handles are pushed per recorded draw and change as the mips arrive, so neither replayed buffers nor the single indirect draw fit
+	if (settings.textureCount > 0 && (!settings.bindless || settings.gpuCulling || settings.staticScene))
+		throw std::runtime_error("--textures requires --bindless and cannot be combined with --gpu-culling or --static-scene");
+
+	return settings;
+}
+
+int main(int argc, char* argv[])
+{
 	try {
+		AppSettings settings = parseArguments(argc, argv);
+		if (settings.jobBenchmark)
+		{
+			runJobSystemBenchmark(std::cout, settings.jobThreads);
+			return 0;
+		}
+		if (settings.cullBenchmark)
+		{
+			runCullingBenchmark(std::cout, settings.jobThreads);
+			return 0;
+		}
+
+		HelloTriangleApplication app(settings);
 		app.run();
 	}
 	catch (const std::exception& e) {
@@ -496,4 +1314,4 @@ int main()
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SPIR-V compiled into the executable when EMBED_SHADERS is defined.
+// The .spv.inc word lists are written by glslc next to the .spv files, by the project build
+// whenever a shader source changes or by hand with compile.bat
+struct EmbeddedShader
+{
+	const char* path;
+	const uint32_t* code;
+	size_t size;
+};
+
+constexpr uint32_t vertShaderCode[] = {
+#include "vert.spv.inc"
+};
+
+constexpr uint32_t bindlessVertShaderCode[] = {
+#include "vert_bindless.spv.inc"
+};
+
+constexpr uint32_t fragShaderCode[] = {
+#include "frag.spv.inc"
+};
+
+constexpr uint32_t texturedFragShaderCode[] = {
+#include "frag_textured.spv.inc"
+};
+
+constexpr uint32_t cullShaderCode[] = {
+#include "cull.spv.inc"
+};
+
+constexpr EmbeddedShader embeddedShaders[] = {
+	{ "shaders/vert.spv", vertShaderCode, sizeof(vertShaderCode) },
+	{ "shaders/vert_bindless.spv", bindlessVertShaderCode, sizeof(bindlessVertShaderCode) },
+	{ "shaders/frag.spv", fragShaderCode, sizeof(fragShaderCode) },
+	{ "shaders/frag_textured.spv", texturedFragShaderCode, sizeof(texturedFragShaderCode) },
+	{ "shaders/cull.spv", cullShaderCode, sizeof(cullShaderCode) },
+};
@@ -0,0 +1,49 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+// The triangle spans [-0.5, 0.5], textures map onto its bounding square
+layout(location = 1) out vec2 fragUV;
+
+// The depth pre-pass and the EQUAL-tested color pass must produce bit-identical depth
+invariant gl_Position;
+
+// Every storage buffer of the bindless set. Read as raw floats, std430 would pad the 24 byte instances to 32
+layout(std430, set = 0, binding = 0) readonly buffer Buffers {
+    float data[];
+} buffers[];
+
+// Same frame constants as shader.vert, in the set after the bindless one
+layout(set = 1, binding = 0) uniform Frame {
+    // Offset x, offset y, zoom, unused
+    vec4 transform;
+} frame;
+
+layout(push_constant) uniform Draw {
+    // Bindless handle of the instance buffer, the same for every invocation of a draw
+    uint instanceBuffer;
+} draw;
+
+// Offset x, offset y, scale, rotation, RGBA8 color, depth
+const uint INSTANCE_FLOATS = 6;
+
+void main() {
+    // gl_InstanceIndex already includes the draw's first instance
+    uint base = uint(gl_InstanceIndex) * INSTANCE_FLOATS;
+    vec4 inTransform = vec4(buffers[draw.instanceBuffer].data[base], buffers[draw.instanceBuffer].data[base + 1],
+        buffers[draw.instanceBuffer].data[base + 2], buffers[draw.instanceBuffer].data[base + 3]);
+    vec4 inInstanceColor = unpackUnorm4x8(floatBitsToUint(buffers[draw.instanceBuffer].data[base + 4]));
+    float inDepth = buffers[draw.instanceBuffer].data[base + 5];
+
+    float s = sin(inTransform.w);
+    float c = cos(inTransform.w);
+    vec2 position = mat2(c, s, -s, c) * inPosition * inTransform.z + inTransform.xy;
+
+    gl_Position = vec4(position * frame.transform.z + frame.transform.xy, inDepth, 1.0);
+    fragColor = inColor * inInstanceColor.rgb;
+    fragUV = inPosition + 0.5;
+}
@@ -1,3 +1,11 @@
 D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe shader.vert -o vert.spv
 D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe shader.frag -o frag.spv
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe cull.comp -o cull.spv
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe bindless.vert -o vert_bindless.spv
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe textured.frag -o frag_textured.spv
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe shader.vert -mfmt=num -o vert.spv.inc
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe shader.frag -mfmt=num -o frag.spv.inc
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe cull.comp -mfmt=num -o cull.spv.inc
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe bindless.vert -mfmt=num -o vert_bindless.spv.inc
+D:/VulkanSDK/1.2.176.1/Bin32/glslc.exe textured.frag -mfmt=num -o frag_textured.spv.inc
 pause
\ No newline at end of file
@@ -1,21 +1,30 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per instance: offset.xy, scale, rotation
+layout(location = 2) in vec4 inTransform;
+layout(location = 3) in vec4 inInstanceColor;
+layout(location = 4) in float inDepth;
+
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+// The depth pre-pass and the EQUAL-tested color pass must produce bit-identical depth
+invariant gl_Position;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// Written once per frame into the uniform ring, bound with a dynamic offset
+layout(set = 0, binding = 0) uniform Frame {
+    // Offset x, offset y, zoom, unused
+    vec4 transform;
+} frame;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    float s = sin(inTransform.w);
+    float c = cos(inTransform.w);
+    vec2 position = mat2(c, s, -s, c) * inPosition * inTransform.z + inTransform.xy;
+
+    gl_Position = vec4(position * frame.transform.z + frame.transform.xy, inDepth, 1.0);
+    fragColor = inColor * inInstanceColor.rgb;
 }
\ No newline at end of file
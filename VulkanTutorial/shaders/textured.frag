@@ -0,0 +1,22 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 1) uniform texture2D images[];
+layout(set = 0, binding = 2) uniform sampler samplers[];
+
+// The push constants of bindless.vert followed by the texture handles of the draw
+layout(push_constant) uniform Draw {
+    uint instanceBuffer;
+    uint image;
+    uint sampler;
+} draw;
+
+void main() {
+    outColor = vec4(fragColor, 1.0) * texture(sampler2D(images[draw.image], samplers[draw.sampler]), fragUV);
+}